@@ -0,0 +1,229 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "InterfaceBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include "ConnectionManager.h"
+#include "LiveRecorder.h"
+#include "RunRegistry.h"
+#include "SimulationCallee.h"
+
+namespace wampinterfaceforomnetpp {
+
+Define_Module(InterfaceBenchmark);
+
+namespace {
+const char BENCHMARK_TOPIC[] = "com.examples.benchmark.samples";
+
+/**
+ * Time a failing warm-up call is retried, e.g. until the SimulationCallee has registered its procedures.
+ */
+const std::chrono::seconds WARMUP_TIMEOUT(10);
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+typedef LiveRecorder<BENCHMARK_TOPIC> BenchmarkRecorder;
+Register_ResultRecorder("liveBenchmark", BenchmarkRecorder);
+
+InterfaceBenchmark::InterfaceBenchmark() :
+        sampleSignal(0), samplesLeft(0), samplesPerEvent(0), latencyStride(0), emitted(0), emitSeconds(0), calls(
+                0), warmupCalls(0), callSeconds(0), failedCalls(0), stopping(false), callsFinished(false), timer(nullptr), doneMsg(nullptr) {
+}
+
+InterfaceBenchmark::~InterfaceBenchmark() {
+    stopClient();
+    cancelAndDelete(timer);
+    cancelAndDelete(doneMsg);
+}
+
+void InterfaceBenchmark::initialize() {
+    mode = par("mode").stringValue();
+    timer = new cMessage("timer");
+    doneMsg = new cMessage("done");
+
+    if (mode == "recorder") {
+        sampleSignal = registerSignal("sample");
+        samplesLeft = par("samples").longValue();
+        samplesPerEvent = par("samplesPerEvent").longValue();
+        latencyStride = par("latencyStride").longValue();
+        eventInterval = par("eventInterval").doubleValue();
+        if (samplesPerEvent < 1 || latencyStride < 1)
+            throw cRuntimeError("samplesPerEvent and latencyStride must be at least 1");
+        collectLatencies.reserve(samplesLeft / latencyStride + 1);
+        scheduleAt(simTime(), timer);
+    } else if (mode == "rpc") {
+        std::string procedure = par("procedure").stringValue();
+        arguments.push_back(par("targetModule").stdstringValue());
+        arguments.push_back(par("targetParameter").stdstringValue());
+        if (procedure == "getParameter") {
+            procedurePath = RunRegistry::qualify(par("getParameterPath").stdstringValue());
+        } else if (procedure == "setParameter") {
+            procedurePath = RunRegistry::qualify(par("setParameterPath").stdstringValue());
+            arguments.push_back(par("targetValue").stdstringValue());
+        } else {
+            throw cRuntimeError("Unknown procedure \"%s\", use getParameter or setParameter", procedure.c_str());
+        }
+        calls = par("calls").longValue();
+        warmupCalls = par("warmupCalls").longValue();
+        loadInterval = par("loadInterval").doubleValue();
+        roundTrips.reserve(calls);
+
+        // the SimulationCallee serves the calls between events, the client runs on its own thread
+        ConnectionManager::getInstance().configureClient(client);
+        client.start();
+        clientThread = std::thread(&InterfaceBenchmark::makeCalls, this);
+        if (loadInterval > 0)
+            scheduleAt(simTime() + loadInterval, timer);
+    } else {
+        throw cRuntimeError("Unknown mode \"%s\", use recorder or rpc", mode.c_str());
+    }
+}
+
+void InterfaceBenchmark::handleMessage(cMessage *msg) {
+    if (msg == timer && mode == "recorder") {
+        emitSamples();
+        if (samplesLeft > 0) {
+            scheduleAt(simTime() + eventInterval, timer);
+            return;
+        }
+        recordScalar("samplesPerSecond", emitted / emitSeconds);
+        recordDistribution("collectLatency", collectLatencies);
+        EV_INFO << "recorder: " << emitted << " samples in " << emitSeconds << "s, " << emitted / emitSeconds
+                << " samples/s" << endl;
+        endSimulation();
+    } else if (msg == timer) {
+        // load of the busy variant, the calls are answered between these events
+        scheduleAt(simTime() + loadInterval, timer);
+    } else if (msg == doneMsg) {
+        stopClient();
+        recordScalar("callsPerSecond", roundTrips.size() / callSeconds);
+        recordScalar("failedCalls", failedCalls.load());
+        recordDistribution("roundTrip", roundTrips);
+        EV_INFO << "rpc: " << roundTrips.size() << " calls of " << procedurePath << " in " << callSeconds << "s, "
+                << failedCalls.load() << " failed" << endl;
+        endSimulation();
+    }
+}
+
+void InterfaceBenchmark::emitSamples() {
+    long count = std::min(samplesLeft, samplesPerEvent);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; ++i) {
+        double value = emitted + i;
+        if ((emitted + i) % latencyStride == 0) {
+            auto sampleStart = std::chrono::steady_clock::now();
+            emit(sampleSignal, value);
+            collectLatencies.push_back(secondsSince(sampleStart) * 1e9);
+        } else {
+            emit(sampleSignal, value);
+        }
+    }
+    emitSeconds += secondsSince(start);
+    emitted += count;
+    samplesLeft -= count;
+}
+
+void InterfaceBenchmark::makeCalls() {
+    auto warmupStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point start;
+    for (long i = -warmupCalls; i < calls && !stopping; ++i) {
+        if (i == 0)
+            start = std::chrono::steady_clock::now();
+
+        auto callStart = std::chrono::steady_clock::now();
+        bool answered = false;
+        try {
+            // throws until the session has joined
+            boost::future<autobahn::wamp_call_result> result = client.request(
+                    [this](std::shared_ptr<autobahn::wamp_session> session) {
+                return session->call(procedurePath, arguments);
+            });
+            if (result.valid()) {
+                // stop() may end the session before the answer arrives
+                while (result.wait_for(boost::chrono::milliseconds(100)) != boost::future_status::ready && !stopping)
+                    ;
+                if (!stopping) {
+                    result.get();
+                    answered = true;
+                }
+            }
+        } catch (const std::exception& e) {
+            if (i >= 0)
+                std::cerr << procedurePath << " failed: " << e.what() << std::endl;
+        }
+
+        if (i < 0) {
+            // until the session has joined and the procedures are registered, warm-up calls are repeated
+            if (!answered && std::chrono::steady_clock::now() - warmupStart < WARMUP_TIMEOUT) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                --i;
+            }
+        } else if (answered) {
+            roundTrips.push_back(secondsSince(callStart) * 1e6);
+        } else {
+            failedCalls++;
+        }
+    }
+    callSeconds = secondsSince(start);
+
+    callsFinished = true;
+
+    // ends the run on the simulation thread, looked up by id as the module may be gone by then
+    int id = getId();
+    SimulationCallee::QueuedRequest done;
+    done.request = [id](SimulationCallee&, std::vector<SimulationCallee::Reply>&) {
+        InterfaceBenchmark *benchmark = dynamic_cast<InterfaceBenchmark*>(getSimulation()->getModule(id));
+        if (benchmark != nullptr)
+            benchmark->callsDone();
+    };
+    done.write = false;
+    SimulationCallee::requests.push(done);
+    WAMPScheduler::notify();
+}
+
+void InterfaceBenchmark::callsDone() {
+    Enter_Method_Silent();
+    if (callsFinished && !doneMsg->isScheduled())
+        scheduleAt(simTime(), doneMsg);
+}
+
+void InterfaceBenchmark::stopClient() {
+    stopping = true;
+    if (clientThread.joinable())
+        clientThread.join();
+    if (client.isRunning())
+        client.stop();
+    client.join();
+}
+
+void InterfaceBenchmark::recordDistribution(const char *prefix, std::vector<double>& values) {
+    if (values.empty())
+        return;
+    std::sort(values.begin(), values.end());
+    std::string name = prefix;
+    recordScalar((name + "Mean").c_str(), std::accumulate(values.begin(), values.end(), 0.0) / values.size());
+    recordScalar((name + "P50").c_str(), values[values.size() / 2]);
+    recordScalar((name + "P99").c_str(), values[std::min(values.size() - 1, values.size() * 99 / 100)]);
+    recordScalar((name + "Max").c_str(), values.back());
+}
+
+} /* namespace wampinterfaceforomnetpp */
@@ -0,0 +1,109 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef INTERFACEBENCHMARK_H_
+#define INTERFACEBENCHMARK_H_
+
+#include <omnetpp.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Drives the benchmarks in simulations/benchmark, see InterfaceBenchmark.ned.
+ *
+ * The results are recorded as scalars, so they can be compared across releases:
+ *  - recorder mode: samplesPerSecond and collectLatencyMean, -P50, -P99 and -Max in nanoseconds
+ *  - rpc mode: callsPerSecond, failedCalls and roundTripMean, -P50, -P99 and -Max in microseconds
+ */
+class InterfaceBenchmark: public omnetpp::cSimpleModule {
+public:
+    InterfaceBenchmark();
+
+    /**
+     * Stops the client session if the run ended before the calls were done.
+     */
+    virtual ~InterfaceBenchmark();
+
+    /**
+     * Called on the simulation thread when the client thread has made all calls, ends the run.
+     */
+    void callsDone();
+
+protected:
+    virtual void initialize() override;
+    virtual void handleMessage(omnetpp::cMessage *msg) override;
+
+private:
+    /**
+     * Emits one event worth of samples and times them.
+     */
+    void emitSamples();
+
+    /**
+     * Makes the calls of the rpc mode. Runs on the client thread.
+     */
+    void makeCalls();
+
+    /**
+     * Stops the client session and waits for the client thread.
+     */
+    void stopClient();
+
+    /**
+     * Records the mean, median, 99th percentile and maximum of the values as scalars with the given prefix.
+     */
+    void recordDistribution(const char *prefix, std::vector<double>& values);
+
+    std::string mode;
+    omnetpp::simsignal_t sampleSignal;
+
+    long samplesLeft;
+    long samplesPerEvent;
+    long latencyStride;
+    omnetpp::simtime_t eventInterval;
+    long emitted;
+    double emitSeconds;
+    std::vector<double> collectLatencies;
+
+    std::string procedurePath;
+    std::vector<std::string> arguments;
+    long calls;
+    long warmupCalls;
+    omnetpp::simtime_t loadInterval;
+    std::vector<double> roundTrips;
+    double callSeconds;
+    std::atomic<long> failedCalls;
+
+    /**
+     * Client session of the rpc mode, with its own connection to the router.
+     */
+    WAMPConnection client;
+    std::thread clientThread;
+    std::atomic<bool> stopping;
+    std::atomic<bool> callsFinished;
+
+    omnetpp::cMessage *timer;
+    omnetpp::cMessage *doneMsg;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* INTERFACEBENCHMARK_H_ */
@@ -0,0 +1,136 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "BridgeMetrics.h"
+
+#include <algorithm>
+
+namespace wampinterfaceforomnetpp {
+
+namespace {
+
+int bucketOf(uint64_t us) {
+    int bucket = 0;
+    while (us > 0 && bucket < LatencyHistogram::NUM_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+double percentile(const std::vector<uint64_t>& buckets, uint64_t count, double fraction, double max) {
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t) (fraction * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(max, (double) (1ULL << i));
+    }
+    return max;
+}
+
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration latency) {
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    if (ns < 0)
+        ns = 0;
+    buckets[bucketOf(ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumNs.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = maxNs.load(std::memory_order_relaxed);
+    while ((uint64_t) ns > max && !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets)
+        bucket = 0;
+    count = 0;
+    sumNs = 0;
+    maxNs = 0;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize() const {
+    // not an atomic snapshot, concurrent records may be counted partially
+    std::vector<uint64_t> counts(NUM_BUCKETS);
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return Summary(0, 0, 0, 0, 0, counts);
+    double mean = sumNs.load(std::memory_order_relaxed) / 1000.0 / total;
+    double max = maxNs.load(std::memory_order_relaxed) / 1000.0;
+    return Summary(total, mean, percentile(counts, total, 0.5, max), percentile(counts, total, 0.99, max), max,
+            counts);
+}
+
+std::map<std::string, uint64_t> ConnectionCounters::toMap() const {
+    std::map<std::string, uint64_t> counters;
+    counters["samplesEnqueued"] = samplesEnqueued;
+    counters["samplesPublished"] = samplesPublished;
+    counters["samplesDropped"] = samplesDropped;
+    counters["samplesCoalesced"] = samplesCoalesced;
+    counters["queueLength"] = queueLength;
+    counters["maxQueueLength"] = maxQueueLength;
+    counters["eventsPublished"] = eventsPublished;
+    counters["bytesPublished"] = bytesPublished;
+    counters["reconnects"] = reconnects;
+    counters["replayDropped"] = replayDropped;
+    return counters;
+}
+
+BridgeMetrics& BridgeMetrics::getInstance() {
+    static BridgeMetrics instance;
+    return instance;
+}
+
+BridgeMetrics::BridgeMetrics() :
+        enabled(true) {
+}
+
+LatencyHistogram& BridgeMetrics::getProcedure(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<LatencyHistogram>& histogram = procedures[name];
+    if (!histogram)
+        histogram.reset(new LatencyHistogram());
+    return *histogram;
+}
+
+void BridgeMetrics::reset() {
+    enqueueToWire.reset();
+    parameterApply.reset();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& procedure : procedures)
+        procedure.second->reset();
+}
+
+std::map<std::string, LatencyHistogram::Summary> BridgeMetrics::summarize() {
+    std::map<std::string, LatencyHistogram::Summary> summaries;
+    summaries["enqueueToWire"] = enqueueToWire.summarize();
+    summaries["parameterApply"] = parameterApply.summarize();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& procedure : procedures)
+        summaries["rpc." + procedure.first] = procedure.second->summarize();
+    return summaries;
+}
+
+} /* namespace wampinterfaceforomnetpp */
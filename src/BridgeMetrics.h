@@ -0,0 +1,156 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef BRIDGEMETRICS_H_
+#define BRIDGEMETRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Histogram of latencies with power-of-two buckets in microseconds.
+ *
+ * Bucket 0 counts latencies below 1us, bucket i those in [2^(i-1), 2^i) us, the last
+ * bucket everything above. Any thread may record, the buckets are relaxed atomics.
+ */
+class LatencyHistogram {
+public:
+    static const int NUM_BUCKETS = 32;
+
+    /**
+     * Count, mean, 50th and 99th percentile and maximum in microseconds, and the bucket counts.
+     * The percentiles are the upper bounds of their buckets.
+     */
+    typedef std::tuple<uint64_t, double, double, double, double, std::vector<uint64_t>> Summary;
+
+    LatencyHistogram();
+
+    void record(std::chrono::steady_clock::duration latency);
+
+    /**
+     * Records the time since start.
+     */
+    void recordSince(std::chrono::steady_clock::time_point start) {
+        record(std::chrono::steady_clock::now() - start);
+    }
+
+    void reset();
+
+    Summary summarize() const;
+
+private:
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sumNs;
+    std::atomic<uint64_t> maxNs;
+};
+
+/**
+ * Counters of one connection of the ConnectionManager pool.
+ */
+struct ConnectionCounters {
+    uint64_t samplesEnqueued;
+    uint64_t samplesPublished;
+    uint64_t samplesDropped;
+    uint64_t samplesCoalesced;
+    uint64_t queueLength;
+    uint64_t maxQueueLength;
+    uint64_t eventsPublished;
+    uint64_t bytesPublished;
+    uint64_t reconnects;
+    uint64_t replayDropped;
+
+    /**
+     * Returns the counters by name, the form they are reported in.
+     */
+    std::map<std::string, uint64_t> toMap() const;
+};
+
+/**
+ * Process-wide latency measurements of the WAMP bridge, enabled with the ini option wamp-metrics.
+ *
+ *  - enqueueToWire:    from a LiveRecorder handing a sample to its LivePublisher until its event
+ *                      is handed to the WAMPConnection, for every wamp-metrics-sample-interval-th sample
+ *  - parameterApply:   from the arrival of a setParameter call until the value is set
+ *  - rpc.<procedure>:  from the arrival of a call until its reply is passed to the session
+ *
+ * The counters of the connections are kept by the LivePublisher and WAMPConnection instances
+ * and collected by the ConnectionManager. The SimulationCallee reports both through its
+ * getMetrics procedure and as scalars.
+ */
+class BridgeMetrics {
+public:
+    static BridgeMetrics& getInstance();
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool enabled) {
+        this->enabled = enabled;
+    }
+
+    LatencyHistogram& getEnqueueToWire() {
+        return enqueueToWire;
+    }
+
+    LatencyHistogram& getParameterApply() {
+        return parameterApply;
+    }
+
+    /**
+     * Returns the histogram of the service times of the procedure, created on first use.
+     * The name is the one of the SimulationCallee function, not the registered URI.
+     */
+    LatencyHistogram& getProcedure(const std::string& name);
+
+    /**
+     * Clears all histograms, e.g. at the start of a run.
+     */
+    void reset();
+
+    /**
+     * Returns the summaries of all histograms by name.
+     */
+    std::map<std::string, LatencyHistogram::Summary> summarize();
+
+private:
+    BridgeMetrics();
+    BridgeMetrics(const BridgeMetrics&) = delete;
+    BridgeMetrics& operator=(const BridgeMetrics&) = delete;
+
+    std::atomic<bool> enabled;
+    LatencyHistogram enqueueToWire;
+    LatencyHistogram parameterApply;
+
+    /**
+     * Guards procedures, the histograms themselves are not moved once created.
+     */
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> procedures;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* BRIDGEMETRICS_H_ */
@@ -0,0 +1,278 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ConnectionManager.h"
+
+#include <functional>
+
+namespace wampinterfaceforomnetpp {
+
+Register_GlobalConfigOption(CFGID_WAMP_CONNECTION_POOL_SIZE, "wamp-connection-pool-size", CFG_INT, "1",
+        "Number of WAMP sessions shared by all LiveRecorders and the SimulationCallee of the process.");
+Register_GlobalConfigOption(CFGID_WAMP_QUEUE_CAPACITY, "wamp-queue-capacity", CFG_INT, "65536",
+        "Number of samples each connection can buffer between the simulation and the I/O thread.");
+Register_GlobalConfigOption(CFGID_WAMP_QUEUE_POLICY, "wamp-queue-policy", CFG_STRING, "block",
+        "What happens to a sample when the queue of its connection is full: block, drop-oldest, drop-newest or latest.");
+Register_GlobalConfigOption(CFGID_WAMP_DEMAND_DRIVEN, "wamp-demand-driven", CFG_BOOL, "false",
+        "Whether LiveRecorders skip topics without subscribers, tracked by the subscription meta events of the router.");
+
+Register_GlobalConfigOption(CFGID_WAMP_TRANSPORT, "wamp-transport", CFG_STRING, "tcp",
+        "Transport of the WAMP sessions: tcp (rawsocket to wamp-router-host:wamp-router-port) or uds "
+        "(rawsocket to the Unix domain socket wamp-router-uds-path, for a router on the same host).");
+Register_GlobalConfigOption(CFGID_WAMP_ROUTER_HOST, "wamp-router-host", CFG_STRING, "127.0.0.1",
+        "Host name or address of the WAMP router for the tcp transport.");
+Register_GlobalConfigOption(CFGID_WAMP_ROUTER_PORT, "wamp-router-port", CFG_INT, "9000",
+        "Port of the rawsocket transport of the WAMP router for the tcp transport.");
+Register_GlobalConfigOption(CFGID_WAMP_ROUTER_UDS_PATH, "wamp-router-uds-path", CFG_FILENAME, "/tmp/crossbar.sock",
+        "Path of the Unix domain socket of the WAMP router for the uds transport.");
+Register_GlobalConfigOption(CFGID_WAMP_REALM, "wamp-realm", CFG_STRING, "opplive",
+        "Realm the WAMP sessions join.");
+Register_GlobalConfigOption(CFGID_WAMP_SERIALIZER, "wamp-serializer", CFG_STRING, "msgpack",
+        "Serializer of the WAMP sessions. autobahn-cpp only implements msgpack.");
+Register_GlobalConfigOption(CFGID_WAMP_RECONNECT_DELAY, "wamp-reconnect-delay", CFG_DOUBLE, "0.5s",
+        "Wall-clock time before the first retry when the WAMP router cannot be reached. It doubles with every "
+        "failed attempt up to wamp-reconnect-max-delay.");
+Register_GlobalConfigOption(CFGID_WAMP_RECONNECT_MAX_DELAY, "wamp-reconnect-max-delay", CFG_DOUBLE, "30s",
+        "Upper bound of the wall-clock time between two attempts to reach the WAMP router.");
+Register_GlobalConfigOption(CFGID_WAMP_REPLAY_CAPACITY, "wamp-replay-capacity", CFG_INT, "10000",
+        "Number of events each connection keeps while it is not joined, e.g. during startup or a router restart. "
+        "They are published once the session has joined again. 0 drops them.");
+Register_GlobalConfigOption(CFGID_WAMP_LOCAL_ROUTER, "wamp-local-router", CFG_BOOL, "false",
+        "Whether the process runs a minimal WAMP router on the configured endpoint while its sessions are connected, "
+        "instead of connecting to an external one, e.g. for benchmarks without Crossbar.io.");
+Register_GlobalConfigOption(CFGID_WAMP_METRICS, "wamp-metrics", CFG_BOOL, "true",
+        "Whether the WAMP bridge measures its latencies, see the getMetrics procedure "
+        "of the SimulationCallee.");
+Register_GlobalConfigOption(CFGID_WAMP_METRICS_BYTES, "wamp-metrics-bytes", CFG_BOOL, "false",
+        "Whether the connections measure the msgpack size of the published events. It packs every event a second "
+        "time, so it is off unless needed.");
+Register_GlobalConfigOption(CFGID_WAMP_METRICS_SAMPLE_INTERVAL, "wamp-metrics-sample-interval", CFG_INT, "64",
+        "With wamp-metrics, every n-th sample of a connection is timestamped to measure the time from its "
+        "enqueue to its publication. 0 disables the measurement.");
+Register_GlobalConfigOption(CFGID_LIVE_SINK, "live-sink", CFG_STRING, "router",
+        "Where LiveRecorders send their samples: router (publish them), spool (append them to live-spool-file "
+        "without connecting to a router) or both.");
+Register_GlobalConfigOption(CFGID_LIVE_SPOOL_FILE, "live-spool-file", CFG_FILENAME,
+        "${resultdir}/${configname}-${iterationvarsf}#${repetition}.livespool",
+        "Memory-mapped binary log the LiveRecorders append to if live-sink is spool or both.");
+
+ConnectionManager& ConnectionManager::getInstance() {
+    static ConnectionManager instance;
+    return instance;
+}
+
+ConnectionManager::ConnectionManager() :
+        users(0), started(false), publishing(true), spooling(false), useLocalRouter(false) {
+}
+
+WAMPConnection& ConnectionManager::acquire(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return *pool[acquireIndex(key, true)];
+}
+
+LivePublisher* ConnectionManager::acquirePublisher(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t index = acquireIndex(key, publishing);
+    return publishing ? publishers[index].get() : nullptr;
+}
+
+LiveSpool* ConnectionManager::getSpool() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spool.isOpen() ? &spool : nullptr;
+}
+
+size_t ConnectionManager::acquireIndex(const std::string& key, bool connect) {
+    if (pool.empty())
+        createPool();
+
+    if (users++ == 0 && spooling) {
+        std::string file = omnetpp::getEnvir()->getConfig()->getAsFilename(CFGID_LIVE_SPOOL_FILE);
+        // each partition of a parallel simulation writes its own spool
+        if (omnetpp::getEnvir()->getParsimNumPartitions() > 1)
+            file += "-partition" + std::to_string(omnetpp::getEnvir()->getParsimProcId());
+        spool.open(file);
+    }
+
+    if (connect && !started) {
+        if (useLocalRouter) {
+            try {
+                localRouter.start();
+            } catch (const std::exception& e) {
+                throw omnetpp::cRuntimeError("Cannot start the local WAMP router: %s", e.what());
+            }
+        }
+        started = true;
+        BridgeMetrics::getInstance().reset();
+        for (size_t i = 0; i < pool.size(); ++i) {
+            publishers[i]->resetCounters();
+            pool[i]->start();
+            // setups do not survive stop(), so the meta subscriptions are added on every start
+            publishers[i]->getDemand().start();
+        }
+        RunRegistry::getInstance().start(*pool[0]);
+    }
+
+    return std::hash<std::string>()(key) % pool.size();
+}
+
+void ConnectionManager::configureClient(WAMPConnection& connection) {
+    WAMPConnection::Transport transport;
+    std::string host;
+    uint16_t port;
+    std::string udsPath;
+    std::string realm;
+    readEndpoint(transport, host, port, udsPath, realm);
+    connection.configure(transport, host, port, udsPath, realm);
+}
+
+void ConnectionManager::readEndpoint(WAMPConnection::Transport& transport, std::string& host, uint16_t& port,
+        std::string& udsPath, std::string& realm) {
+    omnetpp::cConfiguration *config = omnetpp::getEnvir()->getConfig();
+    std::string transportName = config->getAsString(CFGID_WAMP_TRANSPORT);
+    if (transportName == "tcp")
+        transport = WAMPConnection::TCP;
+    else if (transportName == "uds")
+        transport = WAMPConnection::UDS;
+    else
+        throw omnetpp::cRuntimeError("Unknown wamp-transport \"%s\", use tcp or uds", transportName.c_str());
+    if (transport == WAMPConnection::UDS && !WAMPConnection::supportsUds())
+        throw omnetpp::cRuntimeError("wamp-transport uds is not supported on this platform");
+    host = config->getAsString(CFGID_WAMP_ROUTER_HOST);
+    long portNumber = config->getAsInt(CFGID_WAMP_ROUTER_PORT);
+    if (portNumber < 1 || portNumber > 65535)
+        throw omnetpp::cRuntimeError("wamp-router-port must be between 1 and 65535, got %ld", portNumber);
+    port = portNumber;
+    udsPath = config->getAsFilename(CFGID_WAMP_ROUTER_UDS_PATH);
+    realm = config->getAsString(CFGID_WAMP_REALM);
+}
+
+void ConnectionManager::createPool() {
+    omnetpp::cConfiguration *config = omnetpp::getEnvir()->getConfig();
+    long size = config->getAsInt(CFGID_WAMP_CONNECTION_POOL_SIZE);
+    if (size < 1)
+        throw omnetpp::cRuntimeError("wamp-connection-pool-size must be at least 1, got %ld", size);
+    long capacity = config->getAsInt(CFGID_WAMP_QUEUE_CAPACITY);
+    if (capacity < 1)
+        throw omnetpp::cRuntimeError("wamp-queue-capacity must be at least 1, got %ld", capacity);
+    LivePublisher::Policy policy = LivePublisher::parsePolicy(config->getAsString(CFGID_WAMP_QUEUE_POLICY));
+    bool demandDriven = config->getAsBool(CFGID_WAMP_DEMAND_DRIVEN);
+
+    WAMPConnection::Transport transport;
+    std::string host;
+    uint16_t port;
+    std::string udsPath;
+    std::string realm;
+    readEndpoint(transport, host, port, udsPath, realm);
+    double reconnectDelay = config->getAsDouble(CFGID_WAMP_RECONNECT_DELAY);
+    double reconnectMaxDelay = config->getAsDouble(CFGID_WAMP_RECONNECT_MAX_DELAY);
+    if (reconnectDelay <= 0)
+        throw omnetpp::cRuntimeError("wamp-reconnect-delay must be positive, got %g", reconnectDelay);
+    long replayCapacity = config->getAsInt(CFGID_WAMP_REPLAY_CAPACITY);
+    if (replayCapacity < 0)
+        throw omnetpp::cRuntimeError("wamp-replay-capacity must not be negative, got %ld", replayCapacity);
+    std::string sink = config->getAsString(CFGID_LIVE_SINK);
+    if (sink != "router" && sink != "spool" && sink != "both")
+        throw omnetpp::cRuntimeError("Unknown live-sink \"%s\", use router, spool or both", sink.c_str());
+    publishing = sink != "spool";
+    spooling = sink != "router";
+    std::string serializer = config->getAsString(CFGID_WAMP_SERIALIZER);
+    if (serializer != "msgpack")
+        throw omnetpp::cRuntimeError("Unsupported wamp-serializer \"%s\", autobahn-cpp only implements msgpack",
+                serializer.c_str());
+
+    bool metrics = config->getAsBool(CFGID_WAMP_METRICS);
+    long stampInterval = config->getAsInt(CFGID_WAMP_METRICS_SAMPLE_INTERVAL);
+    if (stampInterval < 0)
+        throw omnetpp::cRuntimeError("wamp-metrics-sample-interval must not be negative, got %ld", stampInterval);
+    BridgeMetrics::getInstance().setEnabled(metrics);
+    bool countBytes = config->getAsBool(CFGID_WAMP_METRICS_BYTES);
+
+    // the partitions of a parallel simulation connect to the router of partition 0
+    useLocalRouter = config->getAsBool(CFGID_WAMP_LOCAL_ROUTER) && omnetpp::getEnvir()->getParsimProcId() == 0;
+    if (useLocalRouter)
+        localRouter.configure(transport, host, port, udsPath);
+
+    for (long i = 0; i < size; ++i) {
+        pool.push_back(std::unique_ptr<WAMPConnection>(new WAMPConnection()));
+        pool.back()->configure(transport, host, port, udsPath, realm);
+        pool.back()->setRecovery(reconnectDelay, reconnectMaxDelay, replayCapacity);
+        pool.back()->setByteCounting(countBytes);
+        publishers.push_back(std::unique_ptr<LivePublisher>(new LivePublisher(*pool.back(), capacity, policy, demandDriven)));
+        publishers.back()->setStampInterval(metrics ? stampInterval : 0);
+    }
+}
+
+void ConnectionManager::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (users == 0 || --users > 0)
+        return;
+
+    spool.close();
+    if (!started)
+        return;
+    started = false;
+
+    RunRegistry::getInstance().stop();
+    // the final drain is posted before the leave, so queued samples still go out
+    for (auto& publisher : publishers)
+        publisher->scheduleDrain();
+    for (auto& connection : pool) {
+        if (connection->isRunning())
+            connection->stop();
+    }
+    for (auto& connection : pool)
+        connection->join();
+    // an unjoined connection stops at once, without the final drain
+    for (auto& publisher : publishers)
+        publisher->discardQueued();
+    // after the sessions have left, so they do not try to reconnect
+    localRouter.stop();
+
+    for (size_t i = 0; i < publishers.size(); ++i) {
+        LivePublisher& publisher = *publishers[i];
+        uint64_t replayDropped = pool[i]->getReplayDropped();
+        if (publisher.getDropped() > 0 || publisher.getCoalesced() > 0 || replayDropped > 0)
+            EV_WARN << "connection " << i << ": " << publisher.getEnqueued() << " samples enqueued, "
+                    << publisher.getDropped() << " dropped, " << publisher.getCoalesced() << " coalesced, "
+                    << replayDropped << " events lost while disconnected" << omnetpp::endl;
+    }
+}
+
+std::vector<ConnectionCounters> ConnectionManager::getCounters() {
+    std::vector<ConnectionCounters> counters(pool.size());
+    for (size_t i = 0; i < pool.size(); ++i) {
+        const LivePublisher& publisher = *publishers[i];
+        const WAMPConnection& connection = *pool[i];
+        counters[i].samplesEnqueued = publisher.getEnqueued();
+        counters[i].samplesPublished = publisher.getPublished();
+        counters[i].samplesDropped = publisher.getDropped();
+        counters[i].samplesCoalesced = publisher.getCoalesced();
+        counters[i].queueLength = publisher.getQueueLength();
+        counters[i].maxQueueLength = publisher.getMaxQueueLength();
+        counters[i].eventsPublished = connection.getEventsPublished();
+        counters[i].bytesPublished = connection.getBytesPublished();
+        counters[i].reconnects = connection.getReconnects();
+        counters[i].replayDropped = connection.getReplayDropped();
+    }
+    return counters;
+}
+
+size_t ConnectionManager::getPoolSize() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pool.size();
+}
+
+} /* namespace wampinterfaceforomnetpp */
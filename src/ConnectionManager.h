@@ -0,0 +1,165 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef CONNECTIONMANAGER_H_
+#define CONNECTIONMANAGER_H_
+
+#include <omnetpp.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BridgeMetrics.h"
+#include "LivePublisher.h"
+#include "LiveSpool.h"
+#include "LocalRouter.h"
+#include "RunRegistry.h"
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Process-wide owner of the WAMP sessions.
+ *
+ * All LiveRecorder instances and the SimulationCallee share a small, fixed pool of
+ * connections (ini option wamp-connection-pool-size) instead of opening one session
+ * each. The pool is started by the first user that needs a connection and stopped when
+ * the last user releases it. If live-sink includes the spool, the manager also owns the
+ * LiveSpool the recorders append to while there are users. With wamp-local-router the
+ * manager runs a LocalRouter while the connections are started, and with wamp-run-namespace
+ * it announces the run in the RunRegistry on the first connection.
+ */
+class ConnectionManager {
+public:
+    /**
+     * Returns the single instance of the manager.
+     */
+    static ConnectionManager& getInstance();
+
+    /**
+     * Registers a user of the pool and returns the connection it shall use.
+     * Starts the pool if this is the first user.
+     *
+     * @param key   Key that is hashed to pick a connection, e.g. the topic of a recorder.
+     *              Equal keys always map to the same connection.
+     */
+    WAMPConnection& acquire(const std::string& key);
+
+    /**
+     * Like acquire(), but returns the publisher that hands samples to the I/O thread
+     * of the connection. Returns nullptr if live-sink does not include the router,
+     * the user is registered and has to release() all the same.
+     */
+    LivePublisher* acquirePublisher(const std::string& key);
+
+    /**
+     * Returns the spool of the run, nullptr if live-sink does not include the spool.
+     * Only valid while a user is registered.
+     */
+    LiveSpool* getSpool();
+
+    /**
+     * Unregisters a user. Stops all connections when the last user is gone.
+     */
+    void release();
+
+    /**
+     * Returns the number of connections in the pool.
+     */
+    size_t getPoolSize();
+
+    /**
+     * Returns the counters of the connections of the pool since they were started.
+     * Does not take the lock, so it may be called on the I/O threads of the pool, the pool
+     * does not change once it is created.
+     */
+    std::vector<ConnectionCounters> getCounters();
+
+    /**
+     * Sets the router endpoint and realm of the ini options on a connection that is not part
+     * of the pool, e.g. a client session of a benchmark.
+     */
+    void configureClient(WAMPConnection& connection);
+
+private:
+    ConnectionManager();
+    ConnectionManager(const ConnectionManager&) = delete;
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    /**
+     * Guards users, pool and spool.
+     */
+    std::mutex mutex;
+
+    /**
+     * Number of recorders and callees currently holding a connection.
+     */
+    int users;
+
+    /**
+     * The shared connections, created on first use.
+     */
+    std::vector<std::unique_ptr<WAMPConnection>> pool;
+
+    /**
+     * One publisher per connection, at the same index as the connection in pool.
+     */
+    std::vector<std::unique_ptr<LivePublisher>> publishers;
+
+    /**
+     * Whether the connections were started for the current users.
+     */
+    bool started;
+
+    /**
+     * Sinks selected by live-sink.
+     */
+    bool publishing;
+    bool spooling;
+
+    /**
+     * Spool of the current users, open while there are users if spooling.
+     */
+    LiveSpool spool;
+
+    /**
+     * Router in the process, only started if wamp-local-router is set.
+     */
+    bool useLocalRouter;
+    LocalRouter localRouter;
+
+    /**
+     * Reads and checks the router endpoint and realm options.
+     */
+    void readEndpoint(WAMPConnection::Transport& transport, std::string& host, uint16_t& port,
+            std::string& udsPath, std::string& realm);
+
+    /**
+     * Creates the connections and publishers from the ini options.
+     */
+    void createPool();
+
+    /**
+     * Creates the pool on first use, opens the spool for the first user and starts the
+     * connections if the user needs them. Returns the pool index for the key.
+     * Expects mutex to be held.
+     */
+    size_t acquireIndex(const std::string& key, bool connect);
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* CONNECTIONMANAGER_H_ */
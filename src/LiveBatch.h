@@ -0,0 +1,139 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVEBATCH_H_
+#define LIVEBATCH_H_
+
+#include <omnetpp.h>
+#include <cstdint>
+#include <vector>
+
+#include "LiveValue.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Columnar buffer of the samples of one topic.
+ *
+ * Samples are collected into one column of raw simulation times and one column of values
+ * and are published together as a single event.
+ */
+class LiveBatch {
+public:
+    LiveBatch() :
+            initialized(false), maxSize(1), maxAge(0), firstTime(0) {
+    }
+
+    /**
+     * Forgets the limits of a previous run and drops its samples.
+     */
+    void reset() {
+        initialized = false;
+        maxSize = 1;
+        maxAge = 0;
+        times.clear();
+        values.clear();
+    }
+
+    /**
+     * Tightens the flush limits. Several recorders can share the batch of a topic,
+     * the smallest size and age of all of them apply.
+     *
+     * @param size  Number of samples after which the batch is flushed, 1 disables batching.
+     * @param age   Simulation time span after which the batch is flushed, zero for no limit.
+     */
+    void limitTo(long size, omnetpp::simtime_t age) {
+        if (size < 1)
+            size = 1;
+        int64_t rawAge = age.raw();
+        if (!initialized || (size_t)size < maxSize)
+            maxSize = size;
+        if (!initialized || (rawAge > 0 && (maxAge == 0 || rawAge < maxAge)))
+            maxAge = rawAge;
+        initialized = true;
+        times.reserve(maxSize);
+        values.reserve(maxSize);
+    }
+
+    /**
+     * Returns true if samples are buffered instead of being published one by one.
+     */
+    bool isEnabled() const {
+        return maxSize > 1 || maxAge > 0;
+    }
+
+    /**
+     * Appends a sample to the columns.
+     *
+     * @param time  The raw simulation time of the sample.
+     */
+    void add(int64_t time, const LiveValue& value) {
+        if (times.empty())
+            firstTime = time;
+        times.push_back(time);
+        values.push_back(value);
+    }
+
+    /**
+     * Returns true if the batch reached its size or age limit at the raw time.
+     */
+    bool isDue(int64_t time) const {
+        if (times.empty())
+            return false;
+        return times.size() >= maxSize || (maxAge > 0 && time - firstTime >= maxAge);
+    }
+
+    bool isEmpty() const {
+        return times.empty();
+    }
+
+    /**
+     * Returns the raw simulation time at which the batch is due by its age,
+     * INT64_MAX if it is empty or has no age limit.
+     */
+    int64_t getDeadline() const {
+        if (times.empty() || maxAge == 0)
+            return INT64_MAX;
+        return firstTime + maxAge;
+    }
+
+    size_t size() const {
+        return times.size();
+    }
+
+    /**
+     * Hands out the buffered columns and empties the batch.
+     */
+    void take(std::vector<int64_t>& timeColumn, std::vector<LiveValue>& valueColumn) {
+        timeColumn.swap(times);
+        valueColumn.swap(values);
+        times.clear();
+        values.clear();
+        times.reserve(maxSize);
+        values.reserve(maxSize);
+    }
+
+private:
+    bool initialized;
+    size_t maxSize;
+    int64_t maxAge;
+    int64_t firstTime;
+    std::vector<int64_t> times;
+    std::vector<LiveValue> values;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVEBATCH_H_ */
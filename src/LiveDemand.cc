@@ -0,0 +1,182 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LiveDemand.h"
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+#include "LivePublisher.h"
+
+namespace wampinterfaceforomnetpp {
+
+LiveDemand::LiveDemand(WAMPConnection& connection, bool enabled) :
+        connection(connection), enabled(enabled), available(false), tracking(false) {
+}
+
+void LiveDemand::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        available = false;
+        subscriptions.clear();
+        tracking = enabled;
+        update();
+    }
+    if (enabled)
+        track();
+}
+
+void LiveDemand::attach(LiveTopic *topic) {
+    bool needed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        topics.push_back(topic);
+        topic->observed = isObserved(topic);
+        // without wamp-demand-driven the meta events are only followed for the topics that ask for it
+        needed = topic->alwaysTracked && !tracking;
+        if (needed)
+            tracking = true;
+    }
+    if (needed)
+        track();
+}
+
+void LiveDemand::track() {
+    connection.addSetup([this](WAMPConnection&) {
+        return subscribe();
+    });
+}
+
+void LiveDemand::detach(LiveTopic *topic) {
+    std::lock_guard<std::mutex> lock(mutex);
+    topics.erase(std::remove(topics.begin(), topics.end(), topic), topics.end());
+}
+
+bool LiveDemand::subscribe() {
+    {
+        // runs again after a reconnect, the ids of a restarted router are new
+        std::lock_guard<std::mutex> lock(mutex);
+        available = false;
+        subscriptions.clear();
+        update();
+    }
+
+    try {
+        connection.request([this](std::shared_ptr<autobahn::wamp_session> session) {
+            return session->subscribe("wamp.subscription.on_create", [this](const autobahn::wamp_event& event) {
+                std::lock_guard<std::mutex> lock(mutex);
+                addSubscription(event.argument<std::map<std::string, msgpack::object>>(1));
+                update();
+            });
+        }).get();
+        connection.request([this](std::shared_ptr<autobahn::wamp_session> session) {
+            return session->subscribe("wamp.subscription.on_delete", [this](const autobahn::wamp_event& event) {
+                std::lock_guard<std::mutex> lock(mutex);
+                removeSubscription(event.argument<uint64_t>(1));
+                update();
+            });
+        }).get();
+
+        // subscriptions that existed before this session joined
+        std::map<std::string, std::vector<uint64_t>> existing = connection.request(
+                [](std::shared_ptr<autobahn::wamp_session> session) {
+            return session->call("wamp.subscription.list");
+        }).get().argument<std::map<std::string, std::vector<uint64_t>>>(0);
+        for (auto& match : existing) {
+            for (uint64_t id : match.second) {
+                try {
+                    std::map<std::string, msgpack::object> details = connection.request(
+                            [id](std::shared_ptr<autobahn::wamp_session> session) {
+                        return session->call("wamp.subscription.get", std::make_tuple(id));
+                    }).get().argument<std::map<std::string, msgpack::object>>(0);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    addSubscription(details);
+                } catch (const std::exception& e) {
+                    // deleted in the meantime
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "no subscription meta API, publishing all topics: " << e.what() << std::endl;
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    available = true;
+    update();
+    return true;
+}
+
+void LiveDemand::addSubscription(const std::map<std::string, msgpack::object>& details) {
+    auto id = details.find("id");
+    auto uri = details.find("uri");
+    auto match = details.find("match");
+    if (id == details.end() || uri == details.end())
+        return;
+
+    Subscription& subscription = subscriptions[id->second.as<uint64_t>()];
+    subscription.uri = uri->second.as<std::string>();
+    subscription.match = match != details.end() ? match->second.as<std::string>() : "exact";
+}
+
+void LiveDemand::removeSubscription(uint64_t id) {
+    subscriptions.erase(id);
+}
+
+void LiveDemand::update() {
+    for (LiveTopic *topic : topics)
+        topic->observed = isObserved(topic);
+}
+
+bool LiveDemand::isObserved(const LiveTopic *topic) const {
+    if (!enabled && !topic->alwaysTracked)
+        return true;
+    return !available || isObserved(topic->uri);
+}
+
+bool LiveDemand::isObserved(const std::string& uri) const {
+    for (auto& entry : subscriptions) {
+        const Subscription& subscription = entry.second;
+        if (subscription.match == "prefix") {
+            if (uri.compare(0, subscription.uri.size(), subscription.uri) == 0)
+                return true;
+        } else if (subscription.match == "wildcard") {
+            if (matchesWildcard(subscription.uri, uri))
+                return true;
+        } else if (subscription.uri == uri) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LiveDemand::matchesWildcard(const std::string& pattern, const std::string& uri) {
+    size_t p = 0, u = 0;
+    while (true) {
+        size_t patternEnd = std::min(pattern.find('.', p), pattern.size());
+        size_t uriEnd = std::min(uri.find('.', u), uri.size());
+        if (patternEnd > p && pattern.compare(p, patternEnd - p, uri, u, uriEnd - u) != 0)
+            return false;
+        bool patternDone = patternEnd == pattern.size();
+        bool uriDone = uriEnd == uri.size();
+        if (patternDone || uriDone)
+            return patternDone && uriDone;
+        p = patternEnd + 1;
+        u = uriEnd + 1;
+    }
+}
+
+} /* namespace wampinterfaceforomnetpp */
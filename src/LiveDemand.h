@@ -0,0 +1,133 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVEDEMAND_H_
+#define LIVEDEMAND_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <autobahn/autobahn.hpp>
+
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+struct LiveTopic;
+
+/**
+ * Tracks which topics of a connection have subscribers.
+ *
+ * Subscribes to the subscription meta events of the router (wamp.subscription.on_create
+ * and on_delete) and seeds its state with wamp.subscription.list, so the observed flag of
+ * each attached topic is true exactly while a subscription matches its URI. Recorders of
+ * unobserved topics skip their samples after checking that flag.
+ *
+ * If demand tracking is disabled, only topics flagged alwaysTracked are tracked, and the meta
+ * events are only subscribed once such a topic is attached. Untracked topics, and all topics
+ * while the router does not provide the meta API, are observed.
+ */
+class LiveDemand {
+public:
+    /**
+     * @param connection    The connection whose router is asked for subscriptions.
+     * @param enabled       False to treat every topic that is not alwaysTracked as observed.
+     */
+    LiveDemand(WAMPConnection& connection, bool enabled);
+
+    /**
+     * Subscribes to the meta events once the connection joined, if demand tracking is enabled.
+     * Called on the simulation thread whenever the connection is started.
+     */
+    void start();
+
+    /**
+     * Starts and stops tracking a topic. Called on the simulation thread. Attaching the first
+     * alwaysTracked topic subscribes to the meta events if start() did not.
+     */
+    void attach(LiveTopic *topic);
+    void detach(LiveTopic *topic);
+
+private:
+    /**
+     * Type of match and URI of one subscription on the router.
+     */
+    struct Subscription {
+        std::string match;
+        std::string uri;
+    };
+
+    /**
+     * Adds subscribe() as a setup of the connection.
+     */
+    void track();
+
+    /**
+     * Setup of the connection that subscribes to the meta events and reads the existing subscriptions.
+     */
+    bool subscribe();
+
+    /**
+     * Adds the subscription described by the details dictionary of the meta API.
+     */
+    void addSubscription(const std::map<std::string, msgpack::object>& details);
+
+    void removeSubscription(uint64_t id);
+
+    /**
+     * Recomputes the observed flags of all topics. Called with the mutex held.
+     */
+    void update();
+
+    /**
+     * Returns whether the topic has subscribers as far as known. Called with the mutex held.
+     */
+    bool isObserved(const LiveTopic *topic) const;
+
+    bool isObserved(const std::string& uri) const;
+
+    /**
+     * Matches a URI against a wildcard pattern, where empty components match any component.
+     */
+    static bool matchesWildcard(const std::string& pattern, const std::string& uri);
+
+    WAMPConnection& connection;
+    const bool enabled;
+
+    /**
+     * Guards the state below, which is used by the simulation, the connecter and the I/O thread.
+     */
+    std::mutex mutex;
+
+    /**
+     * True once the meta events are subscribed. Until then all topics are observed.
+     */
+    bool available;
+
+    /**
+     * True once the meta events are a setup of the current start of the connection.
+     */
+    bool tracking;
+
+    std::vector<LiveTopic*> topics;
+    std::map<uint64_t, Subscription> subscriptions;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVEDEMAND_H_ */
@@ -0,0 +1,444 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LivePublisher.h"
+
+#include "BridgeMetrics.h"
+
+#include <algorithm>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace wampinterfaceforomnetpp {
+
+LivePublisher::LivePublisher(WAMPConnection& connection, size_t capacity, Policy policy, bool demandDriven) :
+        connection(connection), ring(capacity), policy(policy), demand(connection, demandDriven), locking(policy == DROP_OLDEST || policy == LATEST),
+        reservedLatest(false), pendingTopics(nullptr), enqueued(0), dropped(0), coalesced(0), published(0),
+        maxQueueLength(0), stampInterval(0), stampCountdown(0), drainScheduled(false), clock(0), nextDeadline(INT64_MAX) {
+    busy.clear();
+}
+
+LivePublisher::Policy LivePublisher::parsePolicy(const std::string& name) {
+    if (name == "block")
+        return BLOCK;
+    if (name == "drop-oldest")
+        return DROP_OLDEST;
+    if (name == "drop-newest")
+        return DROP_NEWEST;
+    if (name == "latest")
+        return LATEST;
+    throw omnetpp::cRuntimeError("Unknown wamp-queue-policy \"%s\", use block, drop-oldest, drop-newest or latest",
+            name.c_str());
+}
+
+void LivePublisher::resetCounters() {
+    enqueued = 0;
+    dropped = 0;
+    coalesced = 0;
+    published = 0;
+    maxQueueLength = 0;
+    clock = 0;
+}
+
+void LivePublisher::discardQueued() {
+    // the I/O thread has ended, so the ring and the topics are not used concurrently
+    uint64_t lost = 0;
+    std::vector<int64_t> times;
+    std::vector<LiveValue> values;
+    for (LiveSample *sample = ring.front(); sample != nullptr; sample = ring.front()) {
+        if (sample->kind == LiveSample::FLUSH) {
+            lost += sample->topic->batch.size();
+            sample->topic->batch.take(times, values);
+        } else {
+            lost++;
+        }
+        ring.popFront();
+    }
+    for (LiveTopic *topic = pendingTopics; topic != nullptr; topic = topic->nextPending) {
+        if (topic->hasLatest) {
+            lost++;
+            topic->hasLatest = false;
+        }
+        if (topic->flushPending) {
+            lost += topic->batch.size();
+            topic->batch.take(times, values);
+            topic->flushPending = false;
+        }
+        topic->pending = false;
+    }
+    pendingTopics = nullptr;
+    dropped += lost;
+}
+
+void LivePublisher::enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, bool b) {
+    LiveSample *sample = reserveValue(topic, time, LiveValue::BOOL);
+    if (sample == nullptr)
+        return;
+    sample->value.b = b;
+    commit();
+}
+
+void LivePublisher::enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, long l) {
+    LiveSample *sample = reserveValue(topic, time, LiveValue::LONG);
+    if (sample == nullptr)
+        return;
+    sample->value.l = l;
+    commit();
+}
+
+void LivePublisher::enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, unsigned long l) {
+    LiveSample *sample = reserveValue(topic, time, LiveValue::ULONG);
+    if (sample == nullptr)
+        return;
+    sample->value.ul = l;
+    commit();
+}
+
+void LivePublisher::enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, double d) {
+    LiveSample *sample = reserveValue(topic, time, LiveValue::DOUBLE);
+    if (sample == nullptr)
+        return;
+    sample->value.d = d;
+    commit();
+}
+
+void LivePublisher::enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, const omnetpp::SimTime& v) {
+    LiveSample *sample = reserveValue(topic, time, LiveValue::SIMTIME);
+    if (sample == nullptr)
+        return;
+    sample->value.t = v.raw();
+    commit();
+}
+
+void LivePublisher::enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, const char *s) {
+    LiveSample *sample = reserveValue(topic, time, LiveValue::STRING);
+    if (sample == nullptr)
+        return;
+    sample->value.s.assign(s); // reuses the capacity of the slot
+    commit();
+}
+
+void LivePublisher::enqueueFlush(LiveTopic *topic) {
+    LiveSample *sample = reserve(topic, false);
+    if (sample == nullptr)
+        return;
+
+    sample->kind = LiveSample::FLUSH;
+    sample->topic = topic;
+    commit();
+}
+
+LiveSample* LivePublisher::reserve(LiveTopic *topic, bool droppable) {
+    reservedLatest = false;
+    if (locking)
+        lock();
+
+    // only set under the latest policy: the topic keeps coalescing until the I/O thread
+    // took its latest sample, so its samples stay in order
+    if (topic->hasLatest) {
+        if (droppable)
+            return coalesce(topic);
+        topic->flushPending = true;
+        unlock();
+        return nullptr;
+    }
+
+    LiveSample *sample = ring.back();
+    if (sample != nullptr)
+        return sample;
+
+    if (droppable) {
+        switch (policy) {
+        case DROP_NEWEST:
+            dropped++;
+            return nullptr;
+        case DROP_OLDEST:
+            evictOldest();
+            return ring.back();
+        case LATEST:
+            return coalesce(topic);
+        default:
+            break;
+        }
+    }
+
+    while (sample == nullptr) {
+        if (locking)
+            unlock();
+        if (!connection.isRunning()) {
+            if (droppable)
+                dropped++;
+            return nullptr;
+        }
+        scheduleDrain();
+        std::this_thread::yield();
+        if (locking)
+            lock();
+        sample = ring.back();
+    }
+    return sample;
+}
+
+LiveSample* LivePublisher::reserveValue(LiveTopic *topic, omnetpp::simtime_t_cref time, LiveValue::Kind kind) {
+    LiveSample *sample = reserve(topic, true);
+    if (sample == nullptr)
+        return nullptr;
+
+    enqueued++;
+    clock.store(time.raw(), std::memory_order_relaxed);
+    sample->kind = LiveSample::VALUE;
+    sample->topic = topic;
+    sample->time = time.raw();
+    sample->value.kind = kind;
+    if (stampInterval > 0 && --stampCountdown == 0) {
+        stampCountdown = stampInterval;
+        sample->stamp = std::chrono::steady_clock::now();
+    } else {
+        sample->stamp = std::chrono::steady_clock::time_point();
+    }
+    return sample;
+}
+
+void LivePublisher::commit() {
+    // a latest sample is already linked to the pending list by coalesce()
+    if (!reservedLatest)
+        ring.commit();
+    if (locking)
+        unlock();
+    scheduleDrain();
+}
+
+void LivePublisher::evictOldest() {
+    LiveSample *oldest = ring.front();
+    if (oldest->kind == LiveSample::FLUSH) {
+        // a flush carries no data, it is kept so the batch of the topic is not stranded;
+        // takeFront() applies it before the next sample of the topic, i.e. at its original position
+        oldest->topic->flushPending = true;
+        if (!oldest->topic->pending) {
+            oldest->topic->pending = true;
+            oldest->topic->nextPending = pendingTopics;
+            pendingTopics = oldest->topic;
+        }
+    } else {
+        dropped++;
+    }
+    ring.popFront();
+}
+
+LiveSample* LivePublisher::coalesce(LiveTopic *topic) {
+    if (topic->hasLatest)
+        coalesced++;
+    topic->hasLatest = true;
+    if (!topic->pending) {
+        topic->pending = true;
+        topic->nextPending = pendingTopics;
+        pendingTopics = topic;
+    }
+    reservedLatest = true;
+    return &topic->latest;
+}
+
+void LivePublisher::lock() {
+    while (busy.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+void LivePublisher::unlock() {
+    busy.clear(std::memory_order_release);
+}
+
+void LivePublisher::publishSummary(LiveTopic *topic, const LiveSummary::Snapshot& snapshot) {
+    connection.post([this, topic, snapshot]() {
+        std::tuple<int64_t, int, long, double, double, double, double, const std::vector<double>&,
+                const std::vector<double>&, unsigned long, unsigned long> summary(snapshot.time,
+                omnetpp::SimTime::getScaleExp(), snapshot.count, snapshot.mean, snapshot.stddev, snapshot.min,
+                snapshot.max, snapshot.edges, snapshot.cells, snapshot.underflow, snapshot.overflow);
+        connection.publish(topic->uri, summary);
+    });
+}
+
+void LivePublisher::advanceClock(omnetpp::simtime_t_cref now) {
+    clock.store(now.raw(), std::memory_order_relaxed);
+    if (now.raw() >= nextDeadline.load(std::memory_order_relaxed))
+        scheduleDrain();
+}
+
+void LivePublisher::scheduleDrain() {
+    // only one drain in flight, so busy topics do not flood the io_service
+    if (!drainScheduled.exchange(true))
+        connection.post([this]() {drain();});
+}
+
+void LivePublisher::drain() {
+    // cleared first, samples committed from now on post a new drain
+    drainScheduled = false;
+
+    size_t length = ring.size();
+    if (length > maxQueueLength.load(std::memory_order_relaxed))
+        maxQueueLength.store(length, std::memory_order_relaxed);
+
+    if (!locking) {
+        for (LiveSample *sample = ring.front(); sample != nullptr; sample = ring.front()) {
+            dispatch(*sample);
+            ring.popFront();
+        }
+        flushAged();
+        return;
+    }
+
+    // the simulation thread may evict from the ring, so samples are moved out before publishing
+    LiveSample sample;
+    bool flushFirst;
+    while (takeFront(sample, flushFirst)) {
+        if (flushFirst)
+            flush(sample.topic);
+        dispatch(sample);
+    }
+    drainPending();
+    flushAged();
+}
+
+bool LivePublisher::takeFront(LiveSample& sample, bool& flushFirst) {
+    lock();
+    LiveSample *front = ring.front();
+    if (front == nullptr) {
+        unlock();
+        return false;
+    }
+    // swapping hands the string capacity back to the slot instead of copying
+    std::swap(sample, *front);
+    ring.popFront();
+    // every sample still in the ring is newer than an evicted flush, so the batch is closed here;
+    // under the latest policy a pending flush belongs after the latest sample instead
+    flushFirst = policy == DROP_OLDEST && sample.topic->flushPending;
+    if (flushFirst)
+        sample.topic->flushPending = false;
+    unlock();
+    return true;
+}
+
+void LivePublisher::drainPending() {
+    lock();
+    for (LiveTopic *topic = pendingTopics; topic != nullptr; topic = topic->nextPending) {
+        if (topic->hasLatest) {
+            pendingSamples.emplace_back();
+            std::swap(pendingSamples.back(), topic->latest);
+            topic->hasLatest = false;
+        }
+        // after the latest sample, so the flush includes it
+        if (topic->flushPending) {
+            pendingSamples.emplace_back();
+            pendingSamples.back().kind = LiveSample::FLUSH;
+            pendingSamples.back().topic = topic;
+            topic->flushPending = false;
+        }
+        topic->pending = false;
+    }
+    pendingTopics = nullptr;
+    unlock();
+
+    for (auto& sample : pendingSamples)
+        dispatch(sample);
+    pendingSamples.clear();
+}
+
+void LivePublisher::dispatch(LiveSample& sample) {
+    LiveTopic *topic = sample.topic;
+
+    if (sample.kind == LiveSample::FLUSH) {
+        flush(topic);
+        return;
+    }
+
+    if (topic->batch.isEnabled()) {
+        if (topic->batchStamp == std::chrono::steady_clock::time_point())
+            topic->batchStamp = sample.stamp;
+        topic->batch.add(sample.time, sample.value);
+        if (topic->batch.isDue(sample.time)) {
+            flush(topic);
+        } else if (!topic->aging && topic->batch.getDeadline() != INT64_MAX) {
+            // the samples of the topic only check its age while they come, the aging list also covers quiet topics
+            topic->aging = true;
+            agingTopics.push_back(topic);
+        }
+        return;
+    }
+
+    if (topic->payload == LiveTopic::TYPED) {
+        std::tuple<int64_t, int, const LiveValue&> arguments(sample.time, omnetpp::SimTime::getScaleExp(),
+                sample.value);
+        connection.publish(topic->uri, arguments);
+    } else {
+        std::tuple<std::string, std::string> arguments = std::make_tuple(
+                omnetpp::SimTime().setRaw(sample.time).str(), sample.value.str());
+        connection.publish(topic->uri, arguments);
+    }
+    published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    recordStamp(sample.stamp);
+}
+
+void LivePublisher::flush(LiveTopic *topic) {
+    if (topic->batch.isEmpty())
+        return;
+
+    std::vector<int64_t> times;
+    std::vector<LiveValue> values;
+    topic->batch.take(times, values);
+
+    if (topic->payload == LiveTopic::TYPED) {
+        std::tuple<const std::vector<int64_t>&, int, const std::vector<LiveValue>&> columns(times,
+                omnetpp::SimTime::getScaleExp(), values);
+        connection.publish(topic->uri, columns);
+    } else {
+        std::tuple<std::vector<std::string>, std::vector<std::string>> columns;
+        std::get<0>(columns).reserve(times.size());
+        std::get<1>(columns).reserve(values.size());
+        for (size_t i = 0; i < times.size(); ++i) {
+            std::get<0>(columns).push_back(omnetpp::SimTime().setRaw(times[i]).str());
+            std::get<1>(columns).push_back(values[i].str());
+        }
+        connection.publish(topic->uri, columns);
+    }
+    published.store(published.load(std::memory_order_relaxed) + times.size(), std::memory_order_relaxed);
+    recordStamp(topic->batchStamp);
+    topic->batchStamp = std::chrono::steady_clock::time_point();
+}
+
+void LivePublisher::flushAged() {
+    int64_t now = clock.load(std::memory_order_relaxed);
+    int64_t earliest = INT64_MAX;
+    size_t kept = 0;
+    for (LiveTopic *topic : agingTopics) {
+        if (topic->batch.getDeadline() <= now)
+            flush(topic);
+        int64_t deadline = topic->batch.getDeadline();
+        if (deadline == INT64_MAX) {
+            topic->aging = false;
+            continue;
+        }
+        earliest = std::min(earliest, deadline);
+        agingTopics[kept++] = topic;
+    }
+    agingTopics.resize(kept);
+    nextDeadline.store(earliest, std::memory_order_relaxed);
+}
+
+void LivePublisher::recordStamp(std::chrono::steady_clock::time_point stamp) {
+    if (stamp != std::chrono::steady_clock::time_point())
+        BridgeMetrics::getInstance().getEnqueueToWire().recordSince(stamp);
+}
+
+} /* namespace wampinterfaceforomnetpp */
@@ -0,0 +1,424 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVEPUBLISHER_H_
+#define LIVEPUBLISHER_H_
+
+#include <omnetpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "LiveBatch.h"
+#include "LiveDemand.h"
+#include "LiveSummary.h"
+#include "LiveValue.h"
+#include "SpscRing.h"
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+struct LiveTopic;
+
+/**
+ * One entry of the hand-off ring between the simulation and the I/O thread.
+ */
+struct LiveSample {
+    enum Kind {
+        VALUE, FLUSH
+    };
+
+    Kind kind;
+    LiveTopic *topic;
+
+    /**
+     * Raw simulation time of the sample.
+     */
+    int64_t time;
+    LiveValue value;
+
+    /**
+     * Wall-clock time of the enqueue if the sample is measured for the enqueueToWire metric,
+     * otherwise the epoch.
+     */
+    std::chrono::steady_clock::time_point stamp;
+};
+
+/**
+ * Publishing state of one topic. Shared by all recorders of the topic,
+ * the batch is only touched by the I/O thread.
+ */
+struct LiveTopic {
+    enum Payload {
+        UNSET, TEXT, TYPED
+    };
+
+    explicit LiveTopic(const char *uri) :
+            uri(uri), payload(UNSET), recorders(0), spoolTopic(-1), alwaysTracked(false), observed(true), aging(false), hasLatest(false), flushPending(false), pending(false),
+            nextPending(nullptr) {
+    }
+
+    std::string uri;
+
+    /**
+     * Whether the events carry formatted strings or native values.
+     */
+    Payload payload;
+
+    /**
+     * Number of recorders attached to the topic, only used on the simulation thread.
+     */
+    int recorders;
+
+    /**
+     * Id of the topic in the LiveSpool, -1 until the first recorder is initialized.
+     */
+    int spoolTopic;
+
+    /**
+     * Whether the LiveDemand tracks the subscribers of the topic also without wamp-demand-driven,
+     * for topics that are only worth producing while somebody listens. Set before the topic is attached.
+     */
+    bool alwaysTracked;
+
+    /**
+     * Whether a client subscribed to the topic, maintained by the LiveDemand of the connection.
+     */
+    std::atomic<bool> observed;
+
+    LiveBatch batch;
+
+    /**
+     * Whether the topic is on the aging list of its publisher, only used on the I/O thread.
+     */
+    bool aging;
+
+    /**
+     * Stamp of the first measured sample in the batch, the epoch if there is none.
+     */
+    std::chrono::steady_clock::time_point batchStamp;
+
+    /**
+     * Work that did not fit into the ring, guarded by the queue lock of the publisher.
+     * latest holds the newest sample of the topic under the latest policy, flushPending
+     * a flush request that was evicted under the drop-oldest policy.
+     */
+    LiveSample latest;
+    bool hasLatest;
+    bool flushPending;
+
+    /**
+     * Links the topics with pending work, so the I/O thread does not scan all topics.
+     */
+    bool pending;
+    LiveTopic *nextPending;
+};
+
+/**
+ * Hands samples from the simulation thread to the I/O thread of a WAMPConnection.
+ *
+ * The simulation thread only writes into a preallocated ring. The I/O thread drains
+ * the ring and does the formatting, batching and publishing, so the session is
+ * only ever used from the thread that runs its io_service.
+ *
+ * Numeric samples are stored in their native type, so enqueueing them neither
+ * allocates nor formats. Only string samples copy their characters.
+ *
+ * The ring is bounded. What happens to a sample that does not fit is chosen by the policy:
+ *  - block:        the simulation waits for the I/O thread; this is only lossless while the
+ *                  router is reachable or an outage fits into the replay buffer of the connection
+ *  - drop-newest:  the new sample is dropped
+ *  - drop-oldest:  the oldest queued sample is dropped to make room
+ *  - latest:       the sample replaces the not yet published newest sample of its topic,
+ *                  later samples of that topic coalesce until the I/O thread picks it up
+ * drop-oldest and latest modify state the I/O thread reads, so they guard the ring with a
+ * spin lock that is only held to fill or take out a single slot.
+ */
+class LivePublisher {
+public:
+    enum Policy {
+        BLOCK, DROP_OLDEST, DROP_NEWEST, LATEST
+    };
+
+    /**
+     * @param connection    The connection the samples are published on.
+     * @param capacity      Number of samples the ring can hold.
+     * @param policy        What to do with samples when the ring is full.
+     * @param demandDriven  Whether topics without subscribers are skipped.
+     */
+    LivePublisher(WAMPConnection& connection, size_t capacity, Policy policy, bool demandDriven);
+
+    /**
+     * Returns the policy of the given name (block, drop-oldest, drop-newest or latest).
+     * Throws a cRuntimeError for unknown names.
+     */
+    static Policy parsePolicy(const std::string& name);
+
+    /**
+     * Each function queues a sample of the respective type. Called on the simulation thread.
+     * A full ring is handled according to the policy.
+     */
+    void enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, bool b);
+    void enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, long l);
+    void enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, unsigned long l);
+    void enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, double d);
+    void enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, const omnetpp::SimTime& v);
+    void enqueue(LiveTopic *topic, omnetpp::simtime_t_cref time, const char *s);
+
+    /**
+     * Queues a request to publish the batch of the topic. Called on the simulation thread.
+     */
+    void enqueueFlush(LiveTopic *topic);
+
+    /**
+     * Publishes a summary of the topic. Called on the simulation thread.
+     * Summaries are rare, so they are posted to the I/O thread directly instead of taking a slot of the ring.
+     */
+    void publishSummary(LiveTopic *topic, const LiveSummary::Snapshot& snapshot);
+
+    /**
+     * Makes sure the I/O thread drains the ring, e.g. before the connection is stopped.
+     */
+    void scheduleDrain();
+
+    /**
+     * Tells the I/O thread the current simulation time, so batches of topics that went quiet are
+     * published once they reach their maximum age. Samples advance the clock as well, this is for
+     * times without samples. Called on the simulation thread, e.g. by a ticker of the WAMPScheduler.
+     */
+    void advanceClock(omnetpp::simtime_t_cref now);
+
+    WAMPConnection& getConnection() {
+        return connection;
+    }
+
+    /**
+     * Subscriber tracking of the topics published on this connection.
+     */
+    LiveDemand& getDemand() {
+        return demand;
+    }
+
+    Policy getPolicy() const {
+        return policy;
+    }
+
+    /**
+     * Number of samples accepted into the queue, including those that were later dropped or coalesced.
+     */
+    uint64_t getEnqueued() const {
+        return enqueued.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of samples that were lost because the queue was full or the connection stopped.
+     */
+    uint64_t getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of samples that were replaced by a newer sample of the same topic.
+     */
+    uint64_t getCoalesced() const {
+        return coalesced.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of samples handed to the connection, batched ones included.
+     */
+    uint64_t getPublished() const {
+        return published.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of samples currently waiting in the ring.
+     */
+    size_t getQueueLength() const {
+        return ring.size();
+    }
+
+    /**
+     * Largest number of samples the I/O thread found in the ring when it started a drain.
+     */
+    size_t getMaxQueueLength() const {
+        return maxQueueLength.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Sets that every n-th sample is timestamped for the enqueueToWire metric of the
+     * BridgeMetrics, 0 disables it. Call before samples are enqueued.
+     */
+    void setStampInterval(unsigned long interval) {
+        stampInterval = interval;
+        stampCountdown = interval;
+    }
+
+    /**
+     * Clears the counters and the clock, e.g. at the start of a run.
+     */
+    void resetCounters();
+
+    /**
+     * Counts the samples the I/O thread did not get to as dropped and forgets them, including
+     * the open batches of the queued flushes. Called after the connection was stopped and joined,
+     * e.g. when it stopped before it ever joined and the final drain did not run.
+     */
+    void discardQueued();
+
+private:
+    /**
+     * Returns a slot for a sample of the topic, applying the policy if the ring is full.
+     * Returns nullptr if the sample is dropped. Flush requests are never dropped by the
+     * policy and wait for the I/O thread instead.
+     * On success the queue lock stays held until commit().
+     */
+    LiveSample* reserve(LiveTopic *topic, bool droppable);
+
+    /**
+     * Reserves a slot for a value sample and fills in everything but the value itself.
+     */
+    LiveSample* reserveValue(LiveTopic *topic, omnetpp::simtime_t_cref time, LiveValue::Kind kind);
+
+    /**
+     * Makes the reserved sample visible and wakes the I/O thread if needed.
+     */
+    void commit();
+
+    /**
+     * Drops the oldest queued sample. A dropped flush request is kept as pending work of its topic
+     * and still closes the batch before any newer sample of the topic.
+     * Called with the queue lock held.
+     */
+    void evictOldest();
+
+    /**
+     * Returns the latest slot of the topic and puts the topic on the pending list.
+     * Called with the queue lock held.
+     */
+    LiveSample* coalesce(LiveTopic *topic);
+
+    void lock();
+    void unlock();
+
+    /**
+     * Publishes all queued samples and then the pending work of the topics. Runs on the I/O thread.
+     */
+    void drain();
+
+    /**
+     * Moves the oldest queued sample into the given one. Returns false if the ring is empty.
+     * flushFirst tells whether an evicted flush of the topic must be published before the sample.
+     * Runs on the I/O thread.
+     */
+    bool takeFront(LiveSample& sample, bool& flushFirst);
+
+    /**
+     * Publishes the latest samples and pending flushes of the topics on the pending list.
+     * Runs on the I/O thread.
+     */
+    void drainPending();
+
+    /**
+     * Publishes or batches a single sample. Runs on the I/O thread.
+     */
+    void dispatch(LiveSample& sample);
+
+    /**
+     * Publishes the batch of the topic as one event. Runs on the I/O thread.
+     */
+    void flush(LiveTopic *topic);
+
+    /**
+     * Publishes the batches on the aging list that reached their maximum age at the clock, and
+     * updates the deadline of the earliest remaining one. Runs on the I/O thread after each drain.
+     */
+    void flushAged();
+
+    /**
+     * Records the enqueueToWire latency of a measured sample. Runs on the I/O thread.
+     */
+    void recordStamp(std::chrono::steady_clock::time_point stamp);
+
+    WAMPConnection& connection;
+    SpscRing<LiveSample> ring;
+    const Policy policy;
+    LiveDemand demand;
+
+    /**
+     * True for the policies that let the simulation thread modify queued samples.
+     */
+    const bool locking;
+    std::atomic_flag busy;
+
+    /**
+     * Set by reserve() when the sample goes to the latest slot of its topic instead of the ring.
+     */
+    bool reservedLatest;
+
+    /**
+     * Topics with a latest sample or a pending flush, guarded by the queue lock.
+     */
+    LiveTopic *pendingTopics;
+
+    /**
+     * Pending work taken from the topics, only used on the I/O thread.
+     */
+    std::vector<LiveSample> pendingSamples;
+
+    std::atomic<uint64_t> enqueued;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> coalesced;
+
+    /**
+     * Only written on the I/O thread.
+     */
+    std::atomic<uint64_t> published;
+    std::atomic<size_t> maxQueueLength;
+
+    /**
+     * Sampling of the enqueueToWire metric, the countdown is only used on the simulation thread.
+     */
+    unsigned long stampInterval;
+    unsigned long stampCountdown;
+
+    /**
+     * True while a drain is posted to the I/O thread and has not started yet.
+     */
+    std::atomic<bool> drainScheduled;
+
+    /**
+     * Newest raw simulation time seen by the simulation thread.
+     */
+    std::atomic<int64_t> clock;
+
+    /**
+     * Raw simulation time at which the earliest batch on the aging list is due, INT64_MAX if
+     * there is none. Written by the I/O thread, read by the simulation thread to decide whether
+     * advancing the clock needs a drain.
+     */
+    std::atomic<int64_t> nextDeadline;
+
+    /**
+     * Topics with an open batch that has an age limit, only used on the I/O thread.
+     */
+    std::vector<LiveTopic*> agingTopics;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVEPUBLISHER_H_ */
@@ -0,0 +1,51 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LiveRecorder.h"
+
+namespace wampinterfaceforomnetpp {
+
+Register_PerObjectConfigOption(CFGID_LIVE_BATCH_SIZE, "live-batch-size", KIND_STATISTIC, CFG_INT, "1",
+        "Number of samples a LiveRecorder collects per topic before publishing them as one event of "
+        "(times, values) arrays. 1 publishes every sample on its own.");
+Register_PerObjectConfigOption(CFGID_LIVE_BATCH_MAX_AGE, "live-batch-max-age", KIND_STATISTIC, CFG_DOUBLE, "0s",
+        "Simulation time after which a LiveRecorder batch is published even if it is not full. 0s means no limit.");
+Register_PerObjectConfigOption(CFGID_LIVE_PAYLOAD, "live-payload", KIND_STATISTIC, CFG_STRING, "text",
+        "Payload of the LiveRecorder events. \"text\" publishes (time, value) as formatted strings, "
+        "\"typed\" publishes (rawTime, scaleExponent, value) with the value in its native type.");
+Register_PerObjectConfigOption(CFGID_LIVE_REDUCTION, "live-reduction", KIND_STATISTIC, CFG_STRING, "none",
+        "Reduction of the samples of a LiveRecorder before publishing: none, min, max, mean or count per "
+        "live-reduction-window, nth (every live-reduction-n-th sample) or lttb (Largest-Triangle-Three-Buckets, "
+        "one point per live-reduction-bucket samples).");
+Register_PerObjectConfigOption(CFGID_LIVE_REDUCTION_WINDOW, "live-reduction-window", KIND_STATISTIC, CFG_DOUBLE, "1s",
+        "Simulation time window of the min, max, mean and count reductions of a LiveRecorder.");
+Register_PerObjectConfigOption(CFGID_LIVE_REDUCTION_N, "live-reduction-n", KIND_STATISTIC, CFG_INT, "10",
+        "Sampling interval of the nth reduction of a LiveRecorder.");
+Register_PerObjectConfigOption(CFGID_LIVE_REDUCTION_BUCKET, "live-reduction-bucket", KIND_STATISTIC, CFG_INT, "100",
+        "Number of samples the lttb reduction of a LiveRecorder reduces to one point.");
+Register_PerObjectConfigOption(CFGID_LIVE_SUMMARY, "live-summary", KIND_STATISTIC, CFG_STRING, "none",
+        "Publishes periodic summaries of the samples of a LiveRecorder instead of the samples themselves: none, "
+        "stddev (count, mean, standard deviation, min and max) or histogram (the same plus live-summary-cells "
+        "histogram cells). Cannot be combined with live-reduction.");
+Register_PerObjectConfigOption(CFGID_LIVE_SUMMARY_CLOCK, "live-summary-clock", KIND_STATISTIC, CFG_STRING, "simtime",
+        "Clock the live-summary-period of a LiveRecorder is measured with: simtime or wallclock.");
+Register_PerObjectConfigOption(CFGID_LIVE_SUMMARY_PERIOD, "live-summary-period", KIND_STATISTIC, CFG_DOUBLE, "1s",
+        "Time between two summaries of a LiveRecorder, in seconds of the live-summary-clock.");
+Register_PerObjectConfigOption(CFGID_LIVE_SUMMARY_CELLS, "live-summary-cells", KIND_STATISTIC, CFG_INT, "10",
+        "Number of cells of the histogram summary of a LiveRecorder.");
+Register_PerObjectConfigOption(CFGID_LIVE_SUMMARY_RESET, "live-summary-reset", KIND_STATISTIC, CFG_BOOL, "false",
+        "Whether each summary of a LiveRecorder only covers the samples since the previous one instead of the whole run.");
+
+} // namespace wampinterfaceforomnetpp
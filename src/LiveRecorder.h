@@ -19,11 +19,31 @@
 #include <stdio.h>
 #include <autobahn/autobahn.hpp>
 #include <autobahn/wamp_publish_options.hpp>
-#include <sstream>
-#include "WAMPConnection.h"
+#include "ConnectionManager.h"
+#include "LivePublisher.h"
+#include "LiveReducer.h"
+#include "LiveSummary.h"
+#include "RunRegistry.h"
+#include "WAMPScheduler.h"
 
 namespace wampinterfaceforomnetpp {
 
+/**
+ * Per statistic options of the LiveRecorder, e.g. **.throughput.live-batch-size = 100
+ */
+extern omnetpp::cConfigOption *CFGID_LIVE_BATCH_SIZE;
+extern omnetpp::cConfigOption *CFGID_LIVE_BATCH_MAX_AGE;
+extern omnetpp::cConfigOption *CFGID_LIVE_PAYLOAD;
+extern omnetpp::cConfigOption *CFGID_LIVE_REDUCTION;
+extern omnetpp::cConfigOption *CFGID_LIVE_REDUCTION_WINDOW;
+extern omnetpp::cConfigOption *CFGID_LIVE_REDUCTION_N;
+extern omnetpp::cConfigOption *CFGID_LIVE_REDUCTION_BUCKET;
+extern omnetpp::cConfigOption *CFGID_LIVE_SUMMARY;
+extern omnetpp::cConfigOption *CFGID_LIVE_SUMMARY_CLOCK;
+extern omnetpp::cConfigOption *CFGID_LIVE_SUMMARY_PERIOD;
+extern omnetpp::cConfigOption *CFGID_LIVE_SUMMARY_CELLS;
+extern omnetpp::cConfigOption *CFGID_LIVE_SUMMARY_RESET;
+
 /**
  * Listener for sending events via WAMP to the router.
  * @param topic     The router topic the event is published to. See the crossbar.io documentation for details about topics.
@@ -31,16 +51,45 @@ namespace wampinterfaceforomnetpp {
 template<char const *topic>
 class LiveRecorder: public omnetpp::cResultRecorder /*public RPCallable<LiveRecorder>*/
 {
+public:
+    /**
+     * Takes the shared connection that serves this topic and the spool from the ConnectionManager.
+     * The first recorder of a run resets the publishing state of the topic, puts its URI into
+     * the namespace of the run and registers it for subscriber tracking.
+     */
+    LiveRecorder();
+
+    /**
+     * Removes the summary ticker and returns the shared connection to the ConnectionManager.
+     */
+    virtual ~LiveRecorder();
+
+    /**
+     * Reads the batching, payload, reduction and summary options of the statistic.
+     */
+    virtual void init(omnetpp::cComponent *component, const char *statisticName, const char *recordingMode,
+            omnetpp::cProperty *attrsProperty, omnetpp::opp_string_map *manualAttrs = nullptr) override;
+
 protected:
     /**
-     * collects the signal and sends the respective event to the WAMP router.
+     * collects the signal and hands it in its native type to the publisher,
+     * which sends the respective event to the WAMP router, and to the spool.
+     * Samples of topics nobody subscribed to are not published, but still spooled.
+     * In a summary mode the sample only updates the statistic, and a summary is published once per period.
      *
-     * @param val   The value that was emitted
+     * @param t     The simulation time the event occurs
+     * @param value The value that was emitted
+     */
+    template<typename T>
+    void collect(omnetpp::simtime_t_cref t, T value);
+
+    /**
+     * Publishes the last summary, the rest of the reduction and the samples that are still buffered in the batch of the topic.
      */
-    virtual void collect(std::string val);
+    virtual void finish(omnetpp::cResultFilter *prev) override;
 
     /**
-     * Each function receives events of a special data type and forwards it as a string to the collect function.
+     * Each function receives events of a special data type and forwards it to the collect function.
      *
      * @param prev      The result filter
      * @param t         The simulation time the event occurs
@@ -63,64 +112,258 @@ protected:
             omnetpp::cObject *obj, omnetpp::cObject *details) override;
 
 private:
-    WAMPConnection connection;
+    /**
+     * Publisher of the shared connection of the ConnectionManager that serves this topic,
+     * nullptr if live-sink does not include the router.
+     */
+    LivePublisher *publisher;
+
+    /**
+     * Spool of the run, nullptr if live-sink does not include the spool.
+     */
+    LiveSpool *spool;
+
+    /**
+     * Hands a sample to the sinks: the publisher if a client observes the topic, and the spool.
+     */
+    template<typename T>
+    void emit(omnetpp::simtime_t_cref t, T value);
+
+    /**
+     * Reduction of the samples of this recorder, e.g. window means or LTTB.
+     */
+    LiveReducer reducer;
+
+    /**
+     * Hands the points produced by the reducer to the sinks.
+     */
+    void publishReduced();
+
+    /**
+     * Distribution of the samples of this recorder, published instead of the samples in a summary mode.
+     */
+    LiveSummary summary;
+
+    /**
+     * Reused for every summary, so taking one does not allocate once the histogram has its cells.
+     */
+    LiveSummary::Snapshot snapshot;
+
+    /**
+     * Takes a summary of the statistic and hands it to the sinks.
+     */
+    void publishSummary(omnetpp::simtime_t_cref t);
+
+    /**
+     * Id of the ticker on the WAMPScheduler that publishes the summaries and aged batches of quiet signals,
+     * -1 if there is none.
+     */
+    int tickerId;
+
+    /**
+     * Publishes the summary if its period is over and advances the clock of the publisher, called by the ticker.
+     */
+    void tick();
+
+    void removeTicker();
+
+    /**
+     * Publishing state shared by all recorders of the topic.
+     */
+    static LiveTopic liveTopic;
 };
 
 template<const char* topic>
-void LiveRecorder<topic>::collect(std::string value) {
-    std::tuple<std::string, std::string> arguments = std::make_tuple(omnetpp::simTime().str(), std::string(value));
-    connection.exec([arguments](std::shared_ptr<autobahn::wamp_session> session){
-        session->publish(topic, arguments);
-        return true;
-    });
+LiveTopic LiveRecorder<topic>::liveTopic(topic);
+
+template<const char* topic>
+LiveRecorder<topic>::LiveRecorder() :
+        publisher(ConnectionManager::getInstance().acquirePublisher(topic)),
+        spool(ConnectionManager::getInstance().getSpool()), tickerId(-1) {
+    if (liveTopic.recorders++ == 0) {
+        // no other recorder of the topic is left from a previous run, so the I/O thread does not read the uri
+        liveTopic.uri = RunRegistry::qualify(topic);
+        liveTopic.payload = LiveTopic::UNSET;
+        liveTopic.batch.reset();
+        liveTopic.spoolTopic = -1;
+        if (publisher != nullptr)
+            publisher->getDemand().attach(&liveTopic);
+    }
+}
+
+template<const char* topic>
+LiveRecorder<topic>::~LiveRecorder() {
+    removeTicker();
+    if (--liveTopic.recorders == 0 && publisher != nullptr)
+        publisher->getDemand().detach(&liveTopic);
+    ConnectionManager::getInstance().release();
+}
+
+template<const char* topic>
+void LiveRecorder<topic>::init(omnetpp::cComponent *component, const char *statisticName,
+        const char *recordingMode, omnetpp::cProperty *attrsProperty, omnetpp::opp_string_map *manualAttrs) {
+    omnetpp::cResultRecorder::init(component, statisticName, recordingMode, attrsProperty, manualAttrs);
+
+    std::string objectPath = component->getFullPath() + "." + statisticName;
+    omnetpp::cConfiguration *config = omnetpp::getEnvir()->getConfig();
+    long size = config->getAsInt(objectPath.c_str(), CFGID_LIVE_BATCH_SIZE);
+    double age = config->getAsDouble(objectPath.c_str(), CFGID_LIVE_BATCH_MAX_AGE);
+    liveTopic.batch.limitTo(size, age);
+
+    std::string payload = config->getAsString(objectPath.c_str(), CFGID_LIVE_PAYLOAD);
+    LiveTopic::Payload requested;
+    if (payload == "text")
+        requested = LiveTopic::TEXT;
+    else if (payload == "typed")
+        requested = LiveTopic::TYPED;
+    else
+        throw omnetpp::cRuntimeError("Unknown live-payload \"%s\" for %s, use \"text\" or \"typed\"",
+                payload.c_str(), objectPath.c_str());
+    if (liveTopic.payload != LiveTopic::UNSET && liveTopic.payload != requested)
+        throw omnetpp::cRuntimeError("Conflicting live-payload for topic %s at %s", topic, objectPath.c_str());
+    liveTopic.payload = requested;
+    if (spool != nullptr && liveTopic.spoolTopic < 0)
+        liveTopic.spoolTopic = spool->addTopic(liveTopic.uri, requested == LiveTopic::TYPED);
+
+    reducer.configure(config->getAsString(objectPath.c_str(), CFGID_LIVE_REDUCTION),
+            config->getAsDouble(objectPath.c_str(), CFGID_LIVE_REDUCTION_WINDOW),
+            config->getAsInt(objectPath.c_str(), CFGID_LIVE_REDUCTION_N),
+            config->getAsInt(objectPath.c_str(), CFGID_LIVE_REDUCTION_BUCKET));
+
+    summary.configure(config->getAsString(objectPath.c_str(), CFGID_LIVE_SUMMARY),
+            config->getAsString(objectPath.c_str(), CFGID_LIVE_SUMMARY_CLOCK),
+            config->getAsDouble(objectPath.c_str(), CFGID_LIVE_SUMMARY_PERIOD),
+            config->getAsInt(objectPath.c_str(), CFGID_LIVE_SUMMARY_CELLS),
+            config->getAsBool(objectPath.c_str(), CFGID_LIVE_SUMMARY_RESET));
+    if (summary.isEnabled() && reducer.isEnabled())
+        throw omnetpp::cRuntimeError("live-summary and live-reduction cannot be combined at %s", objectPath.c_str());
+
+    // samples only check the period and the batch age when they arrive, the ticker also covers quiet signals
+    WAMPScheduler *scheduler = WAMPScheduler::getActive();
+    if ((summary.isEnabled() || age > 0) && scheduler != nullptr)
+        tickerId = scheduler->addTicker([this]() {tick();});
+}
+
+template<const char* topic>
+template<typename T>
+void LiveRecorder<topic>::collect(omnetpp::simtime_t_cref t, T value) {
+    if (spool == nullptr && !liveTopic.observed.load(std::memory_order_relaxed))
+        return;
+
+    if (summary.isEnabled()) {
+        if (summary.collect(t, value))
+            publishSummary(t);
+        return;
+    }
+
+    if (!reducer.isEnabled()) {
+        emit(t, value);
+        return;
+    }
+
+    if (reducer.offer(t, value))
+        emit(t, value);
+    publishReduced();
+}
+
+template<const char* topic>
+template<typename T>
+void LiveRecorder<topic>::emit(omnetpp::simtime_t_cref t, T value) {
+    if (publisher != nullptr && liveTopic.observed.load(std::memory_order_relaxed))
+        publisher->enqueue(&liveTopic, t, value);
+    if (spool != nullptr)
+        spool->append(liveTopic.spoolTopic, t, value);
+}
+
+template<const char* topic>
+void LiveRecorder<topic>::publishReduced() {
+    std::vector<LiveReducer::Point>& points = reducer.getPoints();
+    for (auto& point : points) {
+        if (reducer.isCounting())
+            emit(point.time, (long) point.value);
+        else
+            emit(point.time, point.value);
+    }
+    points.clear();
+}
+
+template<const char* topic>
+void LiveRecorder<topic>::publishSummary(omnetpp::simtime_t_cref t) {
+    summary.take(t, snapshot);
+    if (publisher != nullptr && liveTopic.observed.load(std::memory_order_relaxed))
+        publisher->publishSummary(&liveTopic, snapshot);
+    if (spool != nullptr)
+        spool->appendSummary(liveTopic.spoolTopic, snapshot);
+}
+
+template<const char* topic>
+void LiveRecorder<topic>::tick() {
+    omnetpp::simtime_t now = omnetpp::simTime();
+    if (publisher != nullptr)
+        publisher->advanceClock(now);
+    if (summary.isDue(now))
+        publishSummary(now);
+}
+
+template<const char* topic>
+void LiveRecorder<topic>::removeTicker() {
+    WAMPScheduler *scheduler = WAMPScheduler::getActive();
+    if (tickerId >= 0 && scheduler != nullptr)
+        scheduler->removeTicker(tickerId);
+    tickerId = -1;
+}
+
+template<const char* topic>
+void LiveRecorder<topic>::finish(omnetpp::cResultFilter *prev) {
+    removeTicker();
+    if (summary.hasNewValues())
+        publishSummary(omnetpp::simTime());
+    reducer.finish();
+    publishReduced();
+    if (publisher != nullptr)
+        publisher->enqueueFlush(&liveTopic);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         bool b, omnetpp::cObject* DETAILS_ARG) {
-    collect(b ? "true" : "false");
+    collect(t, b);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         long l, omnetpp::cObject* DETAILS_ARG) {
-    std::stringstream s;
-    s << l;
-    collect(s.str());
+    collect(t, l);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         unsigned long l, omnetpp::cObject* DETAILS_ARG) {
-    std::stringstream s;
-    s << l;
-    collect(s.str());
+    collect(t, l);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         double d, omnetpp::cObject* DETAILS_ARG) {
-    std::stringstream s;
-    s << d;
-    collect(s.str());
+    collect(t, d);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         const omnetpp::SimTime& v, omnetpp::cObject* DETAILS_ARG) {
-    collect(v.str());
+    collect<const omnetpp::SimTime&>(t, v);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         const char *s, omnetpp::cObject* DETAILS_ARG) {
-    collect(s);
+    collect(t, s);
 }
 
 template<const char* topic>
 void LiveRecorder<topic>::receiveSignal(omnetpp::cResultFilter *prev, omnetpp::simtime_t_cref t,
         omnetpp::cObject *obj, omnetpp::cObject* DETAILS_ARG) {
-    collect(obj->getFullPath());
+    collect(t, obj->getFullPath().c_str());
 }
 
 } // namespace wampinterfaceforomnetpp
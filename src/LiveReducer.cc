@@ -0,0 +1,226 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LiveReducer.h"
+
+#include <cmath>
+
+namespace wampinterfaceforomnetpp {
+
+LiveReducer::LiveReducer() :
+        mode(NONE), window(0), windowStart(0), windowCount(0), windowMin(0), windowMax(0), windowSum(0),
+        n(1), skipped(0), bucketSize(0), hasAnchor(false) {
+}
+
+void LiveReducer::configure(const std::string& modeName, omnetpp::simtime_t windowLength, long interval,
+        long bucket) {
+    if (modeName == "none")
+        mode = NONE;
+    else if (modeName == "min")
+        mode = MIN;
+    else if (modeName == "max")
+        mode = MAX;
+    else if (modeName == "mean")
+        mode = MEAN;
+    else if (modeName == "count")
+        mode = COUNT;
+    else if (modeName == "nth")
+        mode = NTH;
+    else if (modeName == "lttb")
+        mode = LTTB;
+    else
+        throw omnetpp::cRuntimeError("Unknown live-reduction \"%s\", use none, min, max, mean, count, nth or lttb",
+                modeName.c_str());
+
+    if ((mode == MIN || mode == MAX || mode == MEAN || mode == COUNT) && windowLength <= SIMTIME_ZERO)
+        throw omnetpp::cRuntimeError("live-reduction-window must be positive for live-reduction \"%s\"",
+                modeName.c_str());
+    if (mode == NTH && interval < 1)
+        throw omnetpp::cRuntimeError("live-reduction-n must be at least 1, got %ld", interval);
+    if (mode == LTTB && bucket < 1)
+        throw omnetpp::cRuntimeError("live-reduction-bucket must be at least 1, got %ld", bucket);
+
+    window = windowLength.raw();
+    windowCount = 0;
+    n = interval;
+    skipped = 0;
+    bucketSize = bucket;
+    hasAnchor = false;
+    current.clear();
+    next.clear();
+    points.clear();
+
+    if (mode == LTTB) {
+        current.reserve(bucketSize);
+        next.reserve(bucketSize);
+    }
+    points.reserve(3);
+}
+
+bool LiveReducer::offer(omnetpp::simtime_t_cref t, double d) {
+    switch (mode) {
+    case NONE:
+        return true;
+    case NTH:
+        return keepNth();
+    case LTTB:
+        downsample(t, d);
+        return false;
+    default:
+        aggregate(t, d);
+        return false;
+    }
+}
+
+bool LiveReducer::offer(omnetpp::simtime_t_cref t, const char *s) {
+    return mode != NTH || keepNth();
+}
+
+bool LiveReducer::keepNth() {
+    // forwards the first sample and every n-th after it
+    if (skipped == 0) {
+        skipped = n - 1;
+        return true;
+    }
+    skipped--;
+    return false;
+}
+
+void LiveReducer::finish() {
+    switch (mode) {
+    case MIN:
+    case MAX:
+    case MEAN:
+    case COUNT:
+        closeWindow();
+        break;
+    case LTTB:
+        if (current.empty())
+            break;
+        if (!next.empty()) {
+            double nextTime = 0, nextValue = 0;
+            for (auto& point : next) {
+                nextTime += point.time.dbl();
+                nextValue += point.value;
+            }
+            emitBucket(nextTime / next.size(), nextValue / next.size());
+        }
+        // like LTTB on a closed series, the last sample is always kept
+        points.push_back(current.back());
+        current.clear();
+        break;
+    default:
+        break;
+    }
+}
+
+void LiveReducer::aggregate(omnetpp::simtime_t_cref t, double d) {
+    int64_t start = t.raw() / window * window;
+    if (windowCount > 0 && start != windowStart)
+        closeWindow();
+
+    if (windowCount == 0) {
+        windowStart = start;
+        windowMin = d;
+        windowMax = d;
+        windowSum = 0;
+    }
+    windowCount++;
+    windowSum += d;
+    if (d < windowMin)
+        windowMin = d;
+    if (d > windowMax)
+        windowMax = d;
+}
+
+void LiveReducer::closeWindow() {
+    if (windowCount == 0)
+        return;
+
+    Point point;
+    point.time = omnetpp::SimTime().setRaw(windowStart);
+    switch (mode) {
+    case MIN:
+        point.value = windowMin;
+        break;
+    case MAX:
+        point.value = windowMax;
+        break;
+    case MEAN:
+        point.value = windowSum / windowCount;
+        break;
+    default:
+        point.value = windowCount;
+        break;
+    }
+    points.push_back(point);
+    windowCount = 0;
+}
+
+void LiveReducer::downsample(omnetpp::simtime_t_cref t, double d) {
+    Point point;
+    point.time = t;
+    point.value = d;
+
+    // the first sample is always kept and anchors the first bucket
+    if (!hasAnchor) {
+        hasAnchor = true;
+        anchor = point;
+        points.push_back(point);
+        return;
+    }
+
+    if (current.size() < bucketSize) {
+        current.push_back(point);
+        return;
+    }
+
+    next.push_back(point);
+    if (next.size() == bucketSize) {
+        double nextTime = 0, nextValue = 0;
+        for (auto& p : next) {
+            nextTime += p.time.dbl();
+            nextValue += p.value;
+        }
+        emitBucket(nextTime / next.size(), nextValue / next.size());
+    }
+}
+
+void LiveReducer::emitBucket(double nextTime, double nextValue) {
+    const Point& selected = selectLargestTriangle(current, nextTime, nextValue);
+    points.push_back(selected);
+    anchor = selected;
+    current.swap(next);
+    next.clear();
+}
+
+const LiveReducer::Point& LiveReducer::selectLargestTriangle(const std::vector<Point>& bucket, double nextTime,
+        double nextValue) const {
+    double anchorTime = anchor.time.dbl();
+    size_t selected = 0;
+    double largestArea = -1;
+    for (size_t i = 0; i < bucket.size(); ++i) {
+        double area = std::fabs(
+                (anchorTime - nextTime) * (bucket[i].value - anchor.value)
+                        - (anchorTime - bucket[i].time.dbl()) * (nextValue - anchor.value));
+        if (area > largestArea) {
+            largestArea = area;
+            selected = i;
+        }
+    }
+    return bucket[selected];
+}
+
+} /* namespace wampinterfaceforomnetpp */
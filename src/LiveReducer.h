@@ -0,0 +1,166 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVEREDUCER_H_
+#define LIVEREDUCER_H_
+
+#include <omnetpp.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Reduces the sample stream of one recorder before it is published.
+ *
+ * Modes:
+ *  - none:                 every sample is forwarded
+ *  - min, max, mean, count: one aggregate per fixed simulation time window,
+ *                          stamped with the start of the window
+ *  - nth:                  every n-th sample is forwarded unchanged
+ *  - lttb:                 Largest-Triangle-Three-Buckets downsampling, one point per bucket of samples
+ *
+ * All state lives on the simulation thread and is allocated in configure(),
+ * so reducing does not allocate per sample.
+ */
+class LiveReducer {
+public:
+    enum Mode {
+        NONE, MIN, MAX, MEAN, COUNT, NTH, LTTB
+    };
+
+    /**
+     * A reduced sample that is ready to be published.
+     */
+    struct Point {
+        omnetpp::simtime_t time;
+        double value;
+    };
+
+    LiveReducer();
+
+    /**
+     * Sets the mode and its parameters. Throws a cRuntimeError for unknown modes or invalid parameters.
+     *
+     * @param mode          One of none, min, max, mean, count, nth and lttb.
+     * @param window        Window length of the aggregating modes.
+     * @param n             Sampling interval of the nth mode.
+     * @param bucketSize    Number of samples that are reduced to one point in lttb mode.
+     */
+    void configure(const std::string& mode, omnetpp::simtime_t window, long n, long bucketSize);
+
+    bool isEnabled() const {
+        return mode != NONE;
+    }
+
+    /**
+     * True if the points of the mode are counts rather than values.
+     */
+    bool isCounting() const {
+        return mode == COUNT;
+    }
+
+    /**
+     * Each function offers a sample of the respective type to the reducer.
+     * Returns true if the sample shall be published unchanged. Otherwise the sample was
+     * either absorbed into an aggregate, which may produce points, or skipped.
+     * Strings cannot be aggregated and are only subject to the nth mode.
+     */
+    bool offer(omnetpp::simtime_t_cref t, double d);
+    bool offer(omnetpp::simtime_t_cref t, bool b) {
+        return offer(t, b ? 1.0 : 0.0);
+    }
+    bool offer(omnetpp::simtime_t_cref t, long l) {
+        return offer(t, (double) l);
+    }
+    bool offer(omnetpp::simtime_t_cref t, unsigned long l) {
+        return offer(t, (double) l);
+    }
+    bool offer(omnetpp::simtime_t_cref t, const omnetpp::SimTime& v) {
+        return offer(t, v.dbl());
+    }
+    bool offer(omnetpp::simtime_t_cref t, const char *s);
+
+    /**
+     * Emits what is left of the current window or buckets at the end of the run.
+     */
+    void finish();
+
+    /**
+     * Points produced by the last offer() or finish() calls. The caller publishes and clears them.
+     */
+    std::vector<Point>& getPoints() {
+        return points;
+    }
+
+private:
+    /**
+     * Returns true for the first sample and every n-th sample after it.
+     */
+    bool keepNth();
+
+    /**
+     * Adds a value to the current window, closing the window if t is beyond it.
+     */
+    void aggregate(omnetpp::simtime_t_cref t, double d);
+
+    /**
+     * Emits the aggregate of the current window.
+     */
+    void closeWindow();
+
+    /**
+     * Adds a value to the buckets and emits the selected point once the following bucket is full.
+     */
+    void downsample(omnetpp::simtime_t_cref t, double d);
+
+    /**
+     * Returns the point of the bucket that spans the largest triangle with the anchor
+     * and the given third point.
+     */
+    const Point& selectLargestTriangle(const std::vector<Point>& bucket, double nextTime, double nextValue) const;
+
+    /**
+     * Emits the point of the current bucket and makes the next bucket the current one.
+     */
+    void emitBucket(double nextTime, double nextValue);
+
+    Mode mode;
+    std::vector<Point> points;
+
+    // window modes
+    int64_t window;
+    int64_t windowStart;
+    long windowCount;
+    double windowMin;
+    double windowMax;
+    double windowSum;
+
+    // nth mode
+    long n;
+    long skipped;
+
+    // lttb mode
+    size_t bucketSize;
+    bool hasAnchor;
+    Point anchor;
+    std::vector<Point> current;
+    std::vector<Point> next;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVEREDUCER_H_ */
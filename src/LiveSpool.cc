@@ -0,0 +1,200 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LiveSpool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Size of the first mapping, doubled whenever the records reach its end.
+ */
+static const size_t INITIAL_MAPPING = 16 * 1024 * 1024;
+
+LiveSpool::LiveSpool() :
+        fd(-1), mapping(nullptr), mapped(0), used(0), topics(0) {
+}
+
+LiveSpool::~LiveSpool() {
+    close();
+}
+
+void LiveSpool::open(const std::string& filename) {
+    close();
+
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw omnetpp::cRuntimeError("Cannot open live spool %s: %s", filename.c_str(), strerror(errno));
+    path = filename;
+    used = 0;
+    topics = 0;
+    grow(INITIAL_MAPPING);
+
+    spool::FileHeader *header = reinterpret_cast<spool::FileHeader*>(reserve(sizeof(spool::FileHeader)));
+    memcpy(header->magic, spool::MAGIC, sizeof(header->magic));
+    header->version = spool::VERSION;
+    header->scaleExp = omnetpp::SimTime::getScaleExp();
+    commit(sizeof(spool::FileHeader));
+}
+
+void LiveSpool::close() {
+    if (fd < 0)
+        return;
+
+    munmap(mapping, mapped);
+    mapping = nullptr;
+    mapped = 0;
+    // the mapping was grown in steps, the file ends with the last record
+    if (ftruncate(fd, used) != 0)
+        std::cerr << "Cannot truncate live spool " << path << ": " << strerror(errno) << std::endl;
+    ::close(fd);
+    fd = -1;
+}
+
+uint16_t LiveSpool::addTopic(const std::string& uri, bool typed) {
+    if (topics == UINT16_MAX)
+        throw omnetpp::cRuntimeError("Live spool %s cannot hold more than %d topics", path.c_str(), UINT16_MAX);
+    uint16_t id = topics++;
+    appendRecord(spool::TOPIC, id, typed ? spool::TYPED : 0, 0, uri.data(), uri.size());
+    return id;
+}
+
+void LiveSpool::append(uint16_t topic, omnetpp::simtime_t_cref time, bool b) {
+    uint64_t word = b ? 1 : 0;
+    appendWord(spool::BOOL, topic, time.raw(), &word);
+}
+
+void LiveSpool::append(uint16_t topic, omnetpp::simtime_t_cref time, long l) {
+    int64_t word = l;
+    appendWord(spool::LONG, topic, time.raw(), &word);
+}
+
+void LiveSpool::append(uint16_t topic, omnetpp::simtime_t_cref time, unsigned long l) {
+    uint64_t word = l;
+    appendWord(spool::ULONG, topic, time.raw(), &word);
+}
+
+void LiveSpool::append(uint16_t topic, omnetpp::simtime_t_cref time, double d) {
+    appendWord(spool::DOUBLE, topic, time.raw(), &d);
+}
+
+void LiveSpool::append(uint16_t topic, omnetpp::simtime_t_cref time, const omnetpp::SimTime& v) {
+    int64_t word = v.raw();
+    appendWord(spool::SIMTIME, topic, time.raw(), &word);
+}
+
+void LiveSpool::append(uint16_t topic, omnetpp::simtime_t_cref time, const char *s) {
+    appendRecord(spool::STRING, topic, 0, time.raw(), s, s != nullptr ? strlen(s) : 0);
+}
+
+void LiveSpool::appendSummary(uint16_t topic, const LiveSummary::Snapshot& snapshot) {
+    spool::SummaryHeader summary;
+    summary.count = snapshot.count;
+    summary.mean = snapshot.mean;
+    summary.stddev = snapshot.stddev;
+    summary.min = snapshot.min;
+    summary.max = snapshot.max;
+    summary.underflow = snapshot.underflow;
+    summary.overflow = snapshot.overflow;
+    summary.numCells = snapshot.cells.size();
+
+    size_t edgesLength = snapshot.edges.size() * sizeof(double);
+    size_t cellsLength = snapshot.cells.size() * sizeof(double);
+    size_t length = sizeof(summary) + edgesLength + cellsLength;
+    size_t total = spool::recordLength(length);
+    char *record = reserve(total);
+
+    spool::RecordHeader *header = reinterpret_cast<spool::RecordHeader*>(record);
+    memset(header, 0, sizeof(*header));
+    header->kind = spool::SUMMARY;
+    header->topic = topic;
+    header->length = length;
+    header->time = snapshot.time;
+    char *payload = record + sizeof(spool::RecordHeader);
+    memcpy(payload, &summary, sizeof(summary));
+    if (edgesLength > 0)
+        memcpy(payload + sizeof(summary), snapshot.edges.data(), edgesLength);
+    if (cellsLength > 0)
+        memcpy(payload + sizeof(summary) + edgesLength, snapshot.cells.data(), cellsLength);
+    commit(total);
+}
+
+void LiveSpool::appendWord(spool::RecordKind kind, uint16_t topic, int64_t time, const void *word) {
+    // header and payload are a multiple of the alignment, no padding to clear
+    const size_t total = sizeof(spool::RecordHeader) + sizeof(uint64_t);
+    char *record = reserve(total);
+    spool::RecordHeader *header = reinterpret_cast<spool::RecordHeader*>(record);
+    memset(header, 0, sizeof(*header));
+    header->kind = kind;
+    header->topic = topic;
+    header->length = sizeof(uint64_t);
+    header->time = time;
+    memcpy(record + sizeof(spool::RecordHeader), word, sizeof(uint64_t));
+    commit(total);
+}
+
+void LiveSpool::appendRecord(spool::RecordKind kind, uint16_t topic, uint16_t flags, int64_t time,
+        const void *payload, size_t length) {
+    if (length > UINT32_MAX)
+        throw omnetpp::cRuntimeError("Record of %zu bytes is too large for live spool %s", length, path.c_str());
+
+    size_t total = spool::recordLength(length);
+    char *record = reserve(total);
+    spool::RecordHeader *header = reinterpret_cast<spool::RecordHeader*>(record);
+    memset(header, 0, sizeof(*header));
+    header->kind = kind;
+    header->topic = topic;
+    header->flags = flags;
+    header->length = length;
+    header->time = time;
+    if (length > 0)
+        memcpy(record + sizeof(spool::RecordHeader), payload, length);
+    // the padding stays zero, the file only grows from the empty one created by open()
+    commit(total);
+}
+
+char *LiveSpool::reserve(size_t length) {
+    if (used + length > mapped)
+        grow(std::max(used + length, mapped * 2));
+    return mapping + used;
+}
+
+void LiveSpool::commit(size_t length) {
+    used += length;
+    reinterpret_cast<spool::FileHeader*>(mapping)->end = used;
+}
+
+void LiveSpool::grow(size_t minimum) {
+    if (mapping != nullptr)
+        munmap(mapping, mapped);
+    mapping = nullptr;
+
+    if (ftruncate(fd, minimum) != 0)
+        throw omnetpp::cRuntimeError("Cannot grow live spool %s: %s", path.c_str(), strerror(errno));
+    void *address = mmap(nullptr, minimum, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+        throw omnetpp::cRuntimeError("Cannot map live spool %s: %s", path.c_str(), strerror(errno));
+    mapping = static_cast<char*>(address);
+    mapped = minimum;
+}
+
+} /* namespace wampinterfaceforomnetpp */
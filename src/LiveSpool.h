@@ -0,0 +1,120 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVESPOOL_H_
+#define LIVESPOOL_H_
+
+#include <omnetpp.h>
+#include <cstdint>
+#include <string>
+
+#include "LiveSpoolFormat.h"
+#include "LiveSummary.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Appends what the LiveRecorders publish to a memory-mapped binary log, see LiveSpoolFormat.h.
+ *
+ * Only used on the simulation thread. Appending a sample copies it into the mapping,
+ * the kernel writes the pages back in the background, so spooling costs neither a
+ * system call nor formatting per sample. The mapping grows by doubling.
+ * The replay tool in tools/ publishes a spool to a router afterwards.
+ */
+class LiveSpool {
+public:
+    LiveSpool();
+
+    /**
+     * Closes the spool.
+     */
+    ~LiveSpool();
+
+    /**
+     * Creates or truncates the file and writes the file header. Throws a cRuntimeError on failure.
+     */
+    void open(const std::string& path);
+
+    /**
+     * Truncates the file to its records and closes it.
+     */
+    void close();
+
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    /**
+     * Writes the definition of a topic and returns its id for the records of the topic.
+     *
+     * @param uri   The topic.
+     * @param typed Whether the topic is published with native values, see live-payload.
+     */
+    uint16_t addTopic(const std::string& uri, bool typed);
+
+    /**
+     * Each function appends a sample of the respective type.
+     */
+    void append(uint16_t topic, omnetpp::simtime_t_cref time, bool b);
+    void append(uint16_t topic, omnetpp::simtime_t_cref time, long l);
+    void append(uint16_t topic, omnetpp::simtime_t_cref time, unsigned long l);
+    void append(uint16_t topic, omnetpp::simtime_t_cref time, double d);
+    void append(uint16_t topic, omnetpp::simtime_t_cref time, const omnetpp::SimTime& v);
+    void append(uint16_t topic, omnetpp::simtime_t_cref time, const char *s);
+
+    /**
+     * Appends a summary of a LiveRecorder in a summary mode.
+     */
+    void appendSummary(uint16_t topic, const LiveSummary::Snapshot& snapshot);
+
+private:
+    /**
+     * Appends a record with the given payload.
+     */
+    void appendRecord(spool::RecordKind kind, uint16_t topic, uint16_t flags, int64_t time, const void *payload,
+            size_t length);
+
+    /**
+     * Appends a record with an 8 byte payload, the common case.
+     */
+    void appendWord(spool::RecordKind kind, uint16_t topic, int64_t time, const void *word);
+
+    /**
+     * Returns a pointer to the given number of bytes at the end of the records, growing the mapping if needed.
+     * The records end is only advanced by commit().
+     */
+    char *reserve(size_t length);
+
+    /**
+     * Adds the reserved bytes to the records and publishes the new end in the file header.
+     */
+    void commit(size_t length);
+
+    /**
+     * Remaps the file with at least the given size.
+     */
+    void grow(size_t minimum);
+
+    std::string path;
+    int fd;
+    char *mapping;
+    size_t mapped;
+    size_t used;
+    uint16_t topics;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVESPOOL_H_ */
@@ -0,0 +1,125 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVESPOOLFORMAT_H_
+#define LIVESPOOLFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Layout of the files written by the LiveSpool and read by the replay tool.
+ * Kept free of OMNeT++ types, so tools can read spools without linking the simulation kernel.
+ *
+ * A spool is a FileHeader followed by records. Each record is a RecordHeader followed by
+ * its payload, padded to a multiple of 8 bytes. All numbers are in the byte order of the
+ * machine that wrote the file.
+ *
+ * Payloads:
+ *  - TOPIC:        the topic uri (without terminating zero), defines RecordHeader::topic for later records
+ *  - BOOL:         uint64 0 or 1
+ *  - LONG:         int64
+ *  - ULONG:        uint64
+ *  - DOUBLE:       double
+ *  - SIMTIME:      int64 raw simulation time
+ *  - STRING:       the characters (without terminating zero)
+ *  - SUMMARY:      a SummaryHeader, then numCells + 1 double cell edges and numCells double cell values,
+ *                  no edges and cells while the histogram is not set up
+ */
+namespace wampinterfaceforomnetpp {
+namespace spool {
+
+const char MAGIC[8] = {'O', 'P', 'P', 'L', 'I', 'V', 'E', 'S'};
+const uint32_t VERSION = 1;
+
+/**
+ * Records start at multiples of this.
+ */
+const size_t ALIGNMENT = 8;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+
+    /**
+     * Simulation time scale exponent of the raw times, time = raw * 10^scaleExp s.
+     */
+    int32_t scaleExp;
+
+    /**
+     * Offset of the end of the last complete record, updated after every record,
+     * so the records of a spool whose writer crashed stay readable.
+     */
+    uint64_t end;
+};
+
+enum RecordKind {
+    TOPIC = 1, BOOL, LONG, ULONG, DOUBLE, SIMTIME, STRING, SUMMARY
+};
+
+/**
+ * Flags of TOPIC records.
+ */
+enum TopicFlags {
+    /**
+     * The recorders of the topic publish native values instead of formatted strings, see live-payload.
+     */
+    TYPED = 1
+};
+
+struct RecordHeader {
+    uint16_t kind;
+    uint16_t topic;
+
+    /**
+     * TopicFlags of TOPIC records, 0 otherwise.
+     */
+    uint16_t flags;
+    uint16_t reserved;
+
+    /**
+     * Length of the payload without padding.
+     */
+    uint32_t length;
+    uint32_t reserved2;
+
+    /**
+     * Raw simulation time of the sample, 0 for TOPIC records.
+     */
+    int64_t time;
+};
+
+struct SummaryHeader {
+    int64_t count;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    uint64_t underflow;
+    uint64_t overflow;
+    uint64_t numCells;
+};
+
+/**
+ * Returns the length of a record with the given payload length, including header and padding.
+ */
+inline size_t recordLength(size_t payloadLength) {
+    return (sizeof(RecordHeader) + payloadLength + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+} /* namespace spool */
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVESPOOLFORMAT_H_ */
@@ -0,0 +1,116 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LiveSummary.h"
+
+namespace wampinterfaceforomnetpp {
+
+LiveSummary::LiveSummary() :
+        mode(NONE), clock(SIMTIME), reset(false), collected(0), period(0), periodStart(0), wallPeriod(0) {
+}
+
+void LiveSummary::configure(const std::string& modeName, const std::string& clockName, double seconds, long cells,
+        bool resetAfterSummary) {
+    if (modeName == "none")
+        mode = NONE;
+    else if (modeName == "stddev")
+        mode = STDDEV;
+    else if (modeName == "histogram")
+        mode = HISTOGRAM;
+    else
+        throw omnetpp::cRuntimeError("Unknown live-summary \"%s\", use none, stddev or histogram", modeName.c_str());
+
+    if (clockName == "simtime")
+        clock = SIMTIME;
+    else if (clockName == "wallclock")
+        clock = WALLCLOCK;
+    else
+        throw omnetpp::cRuntimeError("Unknown live-summary-clock \"%s\", use simtime or wallclock", clockName.c_str());
+
+    if (mode == NONE) {
+        statistic.reset();
+        return;
+    }
+    if (seconds <= 0)
+        throw omnetpp::cRuntimeError("live-summary-period must be positive, got %g", seconds);
+    if (mode == HISTOGRAM && cells < 1)
+        throw omnetpp::cRuntimeError("live-summary-cells must be at least 1, got %ld", cells);
+
+    if (mode == HISTOGRAM)
+        statistic.reset(new omnetpp::cHistogram("live-summary", cells));
+    else
+        statistic.reset(new omnetpp::cStdDev("live-summary"));
+    reset = resetAfterSummary;
+    collected = 0;
+
+    period = omnetpp::SimTime(seconds).raw();
+    periodStart = 0;
+    wallPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds));
+    wallPeriodStart = std::chrono::steady_clock::now();
+}
+
+bool LiveSummary::collect(omnetpp::simtime_t_cref t, double d) {
+    statistic->collect(d);
+    collected++;
+    return isDue(t);
+}
+
+bool LiveSummary::isDue(omnetpp::simtime_t_cref t) const {
+    if (clock == SIMTIME)
+        return t.raw() - periodStart >= period;
+    return std::chrono::steady_clock::now() - wallPeriodStart >= wallPeriod;
+}
+
+void LiveSummary::take(omnetpp::simtime_t_cref t, Snapshot& snapshot) {
+    snapshot.time = t.raw();
+    snapshot.count = statistic->getCount();
+    snapshot.mean = statistic->getMean();
+    snapshot.stddev = statistic->getStddev();
+    snapshot.min = statistic->getMin();
+    snapshot.max = statistic->getMax();
+    snapshot.edges.clear();
+    snapshot.cells.clear();
+    snapshot.underflow = 0;
+    snapshot.overflow = 0;
+
+    if (mode == HISTOGRAM) {
+        omnetpp::cHistogram *histogram = static_cast<omnetpp::cHistogram*>(statistic.get());
+        // the bins are set up after the precollection phase, until then only the moments are known
+        if (histogram->binsAlreadySetUp()) {
+            int numBins = histogram->getNumBins();
+            snapshot.edges.reserve(numBins + 1);
+            snapshot.cells.reserve(numBins);
+            for (int i = 0; i < numBins; ++i) {
+                snapshot.edges.push_back(histogram->getBinEdge(i));
+                snapshot.cells.push_back(histogram->getBinValue(i));
+            }
+            snapshot.edges.push_back(histogram->getBinEdge(numBins));
+            // the samples are not weighted, so the weights are counts
+            snapshot.underflow = (unsigned long) histogram->getUnderflowSumWeights();
+            snapshot.overflow = (unsigned long) histogram->getOverflowSumWeights();
+        }
+    }
+
+    if (reset)
+        statistic->clear();
+    collected = 0;
+
+    // periods are aligned to multiples of the simulation time period, like the reduction windows
+    periodStart = t.raw() / period * period;
+    wallPeriodStart = std::chrono::steady_clock::now();
+}
+
+} /* namespace wampinterfaceforomnetpp */
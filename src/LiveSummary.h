@@ -0,0 +1,153 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVESUMMARY_H_
+#define LIVESUMMARY_H_
+
+#include <omnetpp.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Keeps the distribution of the samples of one recorder inside the simulation and
+ * tells the recorder when a summary of it is due, instead of publishing every sample.
+ *
+ * Modes:
+ *  - none:         no summary, samples are published as they are
+ *  - stddev:       count, mean, standard deviation, min and max in a cStdDev
+ *  - histogram:    the same plus the cells of a cHistogram
+ *
+ * Summaries are due once per period of simulation time or of wall-clock time.
+ * Periods are checked when a sample arrives, and by the recorder between events
+ * if the WAMPScheduler is used, so a quiet signal still produces its summaries.
+ */
+class LiveSummary {
+public:
+    enum Mode {
+        NONE, STDDEV, HISTOGRAM
+    };
+
+    enum Clock {
+        SIMTIME, WALLCLOCK
+    };
+
+    /**
+     * The published summary. The histogram fields stay empty in stddev mode
+     * and until the histogram has collected enough values to set up its bins.
+     */
+    struct Snapshot {
+        /**
+         * Raw simulation time the summary was taken at.
+         */
+        int64_t time;
+        long count;
+        double mean;
+        double stddev;
+        double min;
+        double max;
+
+        /**
+         * Cell boundaries, one more than there are cells.
+         */
+        std::vector<double> edges;
+        std::vector<double> cells;
+        unsigned long underflow;
+        unsigned long overflow;
+    };
+
+    LiveSummary();
+
+    /**
+     * Sets the mode and its parameters. Throws a cRuntimeError for unknown modes or invalid parameters.
+     *
+     * @param mode      One of none, stddev and histogram.
+     * @param clock     simtime or wallclock, the clock the period is measured with.
+     * @param period    Seconds of the respective clock between two summaries.
+     * @param cells     Number of histogram cells.
+     * @param reset     Whether the statistic starts over after each summary instead of covering the whole run.
+     */
+    void configure(const std::string& mode, const std::string& clock, double period, long cells, bool reset);
+
+    bool isEnabled() const {
+        return mode != NONE;
+    }
+
+    /**
+     * Each function adds a sample of the respective type to the statistic.
+     * Returns true if a summary is due. Strings cannot be summarized and are ignored.
+     */
+    bool collect(omnetpp::simtime_t_cref t, double d);
+    bool collect(omnetpp::simtime_t_cref t, bool b) {
+        return collect(t, b ? 1.0 : 0.0);
+    }
+    bool collect(omnetpp::simtime_t_cref t, long l) {
+        return collect(t, (double) l);
+    }
+    bool collect(omnetpp::simtime_t_cref t, unsigned long l) {
+        return collect(t, (double) l);
+    }
+    bool collect(omnetpp::simtime_t_cref t, const omnetpp::SimTime& v) {
+        return collect(t, v.dbl());
+    }
+    bool collect(omnetpp::simtime_t_cref t, const char *s) {
+        return false;
+    }
+
+    /**
+     * True if values were collected since the last summary.
+     */
+    bool hasNewValues() const {
+        return collected > 0;
+    }
+
+    /**
+     * Fills in the summary of the statistic and starts the next period.
+     */
+    void take(omnetpp::simtime_t_cref t, Snapshot& snapshot);
+
+    /**
+     * Returns true if the period that started with the last summary is over.
+     */
+    bool isDue(omnetpp::simtime_t_cref t) const;
+
+private:
+    Mode mode;
+    Clock clock;
+    bool reset;
+
+    /**
+     * A cStdDev in stddev mode, a cHistogram in histogram mode.
+     */
+    std::unique_ptr<omnetpp::cStdDev> statistic;
+
+    /**
+     * Number of values collected since the last summary.
+     */
+    long collected;
+
+    int64_t period;
+    int64_t periodStart;
+    std::chrono::steady_clock::duration wallPeriod;
+    std::chrono::steady_clock::time_point wallPeriodStart;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LIVESUMMARY_H_ */
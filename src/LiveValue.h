@@ -0,0 +1,140 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LIVEVALUE_H_
+#define LIVEVALUE_H_
+
+#include <omnetpp.h>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <msgpack.hpp>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * A signal value in its native type.
+ *
+ * Numeric values are stored in the union, so copying them into a ring slot does not
+ * allocate. Only strings (const char* signals and object paths) use the string member.
+ * Simulation times are kept as raw int64 in the scale of SimTime::getScaleExp().
+ */
+struct LiveValue {
+    enum Kind {
+        BOOL, LONG, ULONG, DOUBLE, SIMTIME, STRING
+    };
+
+    Kind kind;
+    union {
+        bool b;
+        long l;
+        unsigned long ul;
+        double d;
+        int64_t t;
+    };
+    std::string s;
+
+    /**
+     * Formats the value the way the text payload of the LiveRecorder always did.
+     */
+    std::string str() const {
+        std::stringstream out;
+        switch (kind) {
+        case BOOL:
+            return b ? "true" : "false";
+        case LONG:
+            out << l;
+            break;
+        case ULONG:
+            out << ul;
+            break;
+        case DOUBLE:
+            out << d;
+            break;
+        case SIMTIME:
+            return omnetpp::SimTime().setRaw(t).str();
+        case STRING:
+            return s;
+        }
+        return out.str();
+    }
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+namespace msgpack {
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
+namespace adaptor {
+
+/**
+ * Packs a LiveValue as the msgpack type of its native value.
+ */
+template<>
+struct pack<wampinterfaceforomnetpp::LiveValue> {
+    template<typename Stream>
+    msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, const wampinterfaceforomnetpp::LiveValue& v) const {
+        switch (v.kind) {
+        case wampinterfaceforomnetpp::LiveValue::BOOL:
+            return o.pack(v.b);
+        case wampinterfaceforomnetpp::LiveValue::LONG:
+            return o.pack(v.l);
+        case wampinterfaceforomnetpp::LiveValue::ULONG:
+            return o.pack(v.ul);
+        case wampinterfaceforomnetpp::LiveValue::DOUBLE:
+            return o.pack(v.d);
+        case wampinterfaceforomnetpp::LiveValue::SIMTIME:
+            return o.pack(v.t);
+        case wampinterfaceforomnetpp::LiveValue::STRING:
+            return o.pack(v.s);
+        }
+        return o.pack_nil();
+    }
+};
+
+/**
+ * Converts a LiveValue into a msgpack object, which is what autobahn uses for message arguments.
+ */
+template<>
+struct object_with_zone<wampinterfaceforomnetpp::LiveValue> {
+    void operator()(msgpack::object::with_zone& o, const wampinterfaceforomnetpp::LiveValue& v) const {
+        msgpack::object& target = o;
+        switch (v.kind) {
+        case wampinterfaceforomnetpp::LiveValue::BOOL:
+            target = msgpack::object(v.b, o.zone);
+            break;
+        case wampinterfaceforomnetpp::LiveValue::LONG:
+            target = msgpack::object(v.l, o.zone);
+            break;
+        case wampinterfaceforomnetpp::LiveValue::ULONG:
+            target = msgpack::object(v.ul, o.zone);
+            break;
+        case wampinterfaceforomnetpp::LiveValue::DOUBLE:
+            target = msgpack::object(v.d, o.zone);
+            break;
+        case wampinterfaceforomnetpp::LiveValue::SIMTIME:
+            target = msgpack::object(v.t, o.zone);
+            break;
+        case wampinterfaceforomnetpp::LiveValue::STRING:
+            target = msgpack::object(v.s, o.zone);
+            break;
+        }
+    }
+};
+
+} // namespace adaptor
+} // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+} // namespace msgpack
+
+#endif /* LIVEVALUE_H_ */
@@ -0,0 +1,705 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "LocalRouter.h"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#    include <boost/asio/local/stream_protocol.hpp>
+#endif
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wampinterfaceforomnetpp {
+
+namespace {
+
+/**
+ * WAMP message types, see the WAMP basic profile.
+ */
+const uint64_t HELLO = 1;
+const uint64_t WELCOME = 2;
+const uint64_t GOODBYE = 6;
+const uint64_t ERROR = 8;
+const uint64_t PUBLISH = 16;
+const uint64_t PUBLISHED = 17;
+const uint64_t SUBSCRIBE = 32;
+const uint64_t SUBSCRIBED = 33;
+const uint64_t UNSUBSCRIBE = 34;
+const uint64_t UNSUBSCRIBED = 35;
+const uint64_t EVENT = 36;
+const uint64_t CALL = 48;
+const uint64_t RESULT = 50;
+const uint64_t REGISTER = 64;
+const uint64_t REGISTERED = 65;
+const uint64_t UNREGISTER = 66;
+const uint64_t UNREGISTERED = 67;
+const uint64_t INVOCATION = 68;
+const uint64_t YIELD = 70;
+
+/**
+ * Rawsocket transport: handshake octets and frame types.
+ */
+const unsigned char RAWSOCKET_MAGIC = 0x7F;
+const unsigned char SERIALIZER_MSGPACK = 2;
+const unsigned char ERROR_SERIALIZER_UNSUPPORTED = 1;
+const unsigned char MAX_LENGTH_EXPONENT = 0xF; // 2^(9 + 15) = 16 MiB, the limit of the 24 bit frame length
+const unsigned char FRAME_REGULAR = 0;
+const unsigned char FRAME_PING = 1;
+const unsigned char FRAME_PONG = 2;
+const size_t FRAME_HEADER = 4;
+const size_t MAX_FRAME_PAYLOAD = 0xFFFFFF;
+
+/**
+ * A complete frame, shared by all subscribers an event is sent to.
+ */
+typedef std::shared_ptr<const std::vector<char>> Frame;
+
+/**
+ * Stream for msgpack::packer that leaves room for the frame header in front of the message.
+ */
+class FrameBuffer {
+public:
+    FrameBuffer() :
+            bytes(FRAME_HEADER, 0) {
+    }
+
+    void write(const char *data, size_t length) {
+        bytes.insert(bytes.end(), data, data + length);
+    }
+
+    Frame finish(unsigned char type = FRAME_REGULAR) {
+        size_t length = bytes.size() - FRAME_HEADER;
+        if (length > MAX_FRAME_PAYLOAD)
+            throw std::runtime_error("message of " + std::to_string(length) + " bytes exceeds the rawsocket frame");
+        bytes[0] = type;
+        bytes[1] = (length >> 16) & 0xFF;
+        bytes[2] = (length >> 8) & 0xFF;
+        bytes[3] = length & 0xFF;
+        return std::make_shared<std::vector<char>>(std::move(bytes));
+    }
+
+private:
+    std::vector<char> bytes;
+};
+
+typedef msgpack::packer<FrameBuffer> Packer;
+
+void require(uint32_t size, uint32_t minimum) {
+    if (size < minimum)
+        throw std::runtime_error("message has " + std::to_string(size) + " fields, expected at least "
+                + std::to_string(minimum));
+}
+
+/**
+ * Returns the boolean option of a WAMP options or details dictionary.
+ */
+bool getOption(const msgpack::object& options, const std::string& key, bool defaultValue) {
+    if (options.type != msgpack::type::MAP)
+        return defaultValue;
+    for (uint32_t i = 0; i < options.via.map.size; ++i) {
+        const msgpack::object_kv& entry = options.via.map.ptr[i];
+        if (entry.key.type == msgpack::type::STR && entry.key.as<std::string>() == key)
+            return entry.val.type == msgpack::type::BOOLEAN ? entry.val.via.boolean : defaultValue;
+    }
+    return defaultValue;
+}
+
+/**
+ * Returns the string option of a WAMP options dictionary, "" if it is not given.
+ */
+std::string getStringOption(const msgpack::object& options, const std::string& key) {
+    if (options.type != msgpack::type::MAP)
+        return "";
+    for (uint32_t i = 0; i < options.via.map.size; ++i) {
+        const msgpack::object_kv& entry = options.via.map.ptr[i];
+        if (entry.key.type == msgpack::type::STR && entry.key.as<std::string>() == key)
+            return entry.val.type == msgpack::type::STR ? entry.val.as<std::string>() : "";
+    }
+    return "";
+}
+
+/**
+ * Packs a dictionary that is empty or has a single true flag, e.g. {"progress": true}.
+ */
+void packFlag(Packer& packer, const char *key, bool set) {
+    if (!set) {
+        packer.pack_map(0);
+        return;
+    }
+    packer.pack_map(1);
+    packer.pack(std::string(key));
+    packer.pack(true);
+}
+
+/**
+ * Packs the arguments and keyword arguments at the end of a message, they are forwarded unchanged.
+ */
+void packTail(Packer& packer, const msgpack::object *fields, uint32_t size, uint32_t first) {
+    for (uint32_t i = first; i < size; ++i)
+        packer.pack(fields[i]);
+}
+
+Frame makeError(uint64_t requestType, uint64_t request, const char *uri) {
+    FrameBuffer frame;
+    Packer packer(frame);
+    packer.pack_array(5);
+    packer.pack(ERROR);
+    packer.pack(requestType);
+    packer.pack(request);
+    packer.pack_map(0);
+    packer.pack(std::string(uri));
+    return frame.finish();
+}
+
+/**
+ * Makes a reply that only carries the request id and optionally another id, e.g. SUBSCRIBED.
+ */
+Frame makeAcknowledgement(uint64_t type, uint64_t request, const uint64_t *id = nullptr) {
+    FrameBuffer frame;
+    Packer packer(frame);
+    packer.pack_array(id != nullptr ? 3 : 2);
+    packer.pack(type);
+    packer.pack(request);
+    if (id != nullptr)
+        packer.pack(*id);
+    return frame.finish();
+}
+
+} // namespace
+
+/**
+ * Connection of one session: reads the rawsocket frames, hands the messages to the router
+ * and writes the queued frames in order.
+ */
+class LocalRouter::Peer: public std::enable_shared_from_this<LocalRouter::Peer> {
+public:
+    explicit Peer(LocalRouter& router) :
+            socket(router.io), joined(false), router(router), closed(false), writing(false) {
+    }
+
+    boost::asio::generic::stream_protocol::socket socket;
+
+    /**
+     * Whether the session has joined the realm, i.e. sent HELLO.
+     */
+    bool joined;
+
+    void start() {
+        auto self = shared_from_this();
+        boost::asio::async_read(socket, boost::asio::buffer(handshake),
+                [this, self](const boost::system::error_code& error, size_t) {
+            if (error) {
+                close();
+                return;
+            }
+            // the client sends the magic octet, its maximum message length and the serializer
+            if (handshake[0] != RAWSOCKET_MAGIC || (handshake[1] & 0x0F) != SERIALIZER_MSGPACK) {
+                unsigned char reply[] = {RAWSOCKET_MAGIC, ERROR_SERIALIZER_UNSUPPORTED << 4, 0, 0};
+                boost::system::error_code ignored;
+                boost::asio::write(socket, boost::asio::buffer(reply), ignored);
+                close();
+                return;
+            }
+            send(std::make_shared<std::vector<char>>(std::vector<char> {(char) RAWSOCKET_MAGIC,
+                    (char) (MAX_LENGTH_EXPONENT << 4 | SERIALIZER_MSGPACK), 0, 0}));
+            readHeader();
+        });
+    }
+
+    void send(const Frame& frame) {
+        if (closed)
+            return;
+        outgoing.push_back(frame);
+        if (!writing)
+            write();
+    }
+
+    /**
+     * Closes the connection and removes the session from the router. Does nothing if already closed.
+     */
+    void close() {
+        if (closed)
+            return;
+        closed = true;
+        boost::system::error_code ignored;
+        socket.close(ignored);
+        router.detach(shared_from_this());
+    }
+
+private:
+    void readHeader() {
+        auto self = shared_from_this();
+        boost::asio::async_read(socket, boost::asio::buffer(header),
+                [this, self](const boost::system::error_code& error, size_t) {
+            if (error) {
+                close();
+                return;
+            }
+            payload.resize((size_t(header[1]) << 16) | (size_t(header[2]) << 8) | header[3]);
+            boost::asio::async_read(socket, boost::asio::buffer(payload),
+                    [this, self](const boost::system::error_code& error, size_t) {
+                if (error) {
+                    close();
+                    return;
+                }
+                receive(header[0] & 0x07);
+                if (!closed)
+                    readHeader();
+            });
+        });
+    }
+
+    void receive(unsigned char type) {
+        if (type == FRAME_PING) {
+            FrameBuffer pong;
+            pong.write(payload.data(), payload.size());
+            send(pong.finish(FRAME_PONG));
+            return;
+        }
+        if (type != FRAME_REGULAR)
+            return;
+
+        try {
+            msgpack::object_handle message = msgpack::unpack(payload.data(), payload.size());
+            router.route(shared_from_this(), message.get());
+        } catch (const std::exception& e) {
+            std::cerr << "local WAMP router: closing session after malformed message: " << e.what() << std::endl;
+            close();
+        }
+    }
+
+    /**
+     * Writes all queued frames at once, so a burst of events costs a single system call.
+     */
+    void write() {
+        writing = true;
+        inFlight.assign(outgoing.begin(), outgoing.end());
+        outgoing.clear();
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.reserve(inFlight.size());
+        for (const Frame& frame : inFlight)
+            buffers.push_back(boost::asio::buffer(*frame));
+
+        auto self = shared_from_this();
+        boost::asio::async_write(socket, buffers, [this, self](const boost::system::error_code& error, size_t) {
+            inFlight.clear();
+            if (error) {
+                close();
+                return;
+            }
+            if (outgoing.empty())
+                writing = false;
+            else
+                write();
+        });
+    }
+
+    LocalRouter& router;
+    unsigned char handshake[4];
+    unsigned char header[FRAME_HEADER];
+    std::vector<char> payload;
+    std::deque<Frame> outgoing;
+    std::vector<Frame> inFlight;
+    bool closed;
+    bool writing;
+};
+
+LocalRouter::LocalRouter() :
+        transport(WAMPConnection::TCP), host("127.0.0.1"), port(9000), udsPath("/tmp/crossbar.sock"), running(
+                false), received(0), lastId(0) {
+}
+
+LocalRouter::~LocalRouter() {
+    stop();
+}
+
+void LocalRouter::configure(WAMPConnection::Transport transport, const std::string& host, uint16_t port,
+        const std::string& udsPath) {
+    this->transport = transport;
+    this->host = host;
+    this->port = port;
+    this->udsPath = udsPath;
+}
+
+void LocalRouter::start() {
+    if (running)
+        return;
+
+    boost::asio::generic::stream_protocol::endpoint endpoint;
+    if (transport == WAMPConnection::UDS) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        // the socket of a previous run would fail the bind, anything else is not ours to remove
+        struct stat status;
+        if (stat(udsPath.c_str(), &status) == 0) {
+            if (!S_ISSOCK(status.st_mode))
+                throw std::runtime_error(udsPath + " exists and is not a socket");
+            unlink(udsPath.c_str());
+        }
+        endpoint = boost::asio::generic::stream_protocol::endpoint(
+                boost::asio::local::stream_protocol::endpoint(udsPath));
+#else
+        throw std::runtime_error("Unix domain sockets are not supported on this platform");
+#endif
+    } else {
+        boost::asio::ip::tcp::resolver resolver(io);
+        boost::asio::ip::tcp::resolver::query query(host, std::to_string(port));
+        endpoint = boost::asio::generic::stream_protocol::endpoint(resolver.resolve(query)->endpoint());
+    }
+
+    io.reset(); // allow restarting after a previous stop()
+    acceptor.reset(new Acceptor(io));
+    acceptor->open(endpoint.protocol());
+    if (transport == WAMPConnection::TCP)
+        acceptor->set_option(boost::asio::socket_base::reuse_address(true));
+    acceptor->bind(endpoint);
+    acceptor->listen();
+
+    received = 0;
+    lastId = 0;
+    running = true;
+    accept();
+    runner = std::thread([this]() {
+        try {
+            io.run();
+        } catch (const std::exception& e) {
+            std::cerr << "local WAMP router: " << e.what() << std::endl;
+        }
+        running = false;
+    });
+}
+
+void LocalRouter::stop() {
+    if (!runner.joinable())
+        return;
+
+    // without the acceptor and the connections the io service runs out of work
+    io.post([this]() {
+        boost::system::error_code ignored;
+        acceptor->close(ignored);
+        std::set<std::shared_ptr<Peer>> open = peers;
+        for (auto& peer : open)
+            peer->close();
+    });
+    runner.join();
+
+    acceptor.reset();
+    peers.clear();
+    subscriptions.clear();
+    subscriptionTopics.clear();
+    registrations.clear();
+    registrationProcedures.clear();
+    invocations.clear();
+    struct stat status;
+    if (transport == WAMPConnection::UDS && stat(udsPath.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+        unlink(udsPath.c_str());
+}
+
+void LocalRouter::accept() {
+    std::shared_ptr<Peer> peer = std::make_shared<Peer>(*this);
+    acceptor->async_accept(peer->socket, [this, peer](const boost::system::error_code& error) {
+        if (error) {
+            // closed by stop()
+            return;
+        }
+        if (transport == WAMPConnection::TCP) {
+            boost::system::error_code ignored;
+            peer->socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+        }
+        peers.insert(peer);
+        peer->start();
+        accept();
+    });
+}
+
+void LocalRouter::route(const std::shared_ptr<Peer>& peer, const msgpack::object& message) {
+    received++;
+    if (message.type != msgpack::type::ARRAY || message.via.array.size == 0)
+        throw std::runtime_error("message is not an array");
+    const msgpack::object *fields = message.via.array.ptr;
+    uint32_t size = message.via.array.size;
+    uint64_t type = fields[0].as<uint64_t>();
+
+    if (!peer->joined) {
+        if (type != HELLO)
+            throw std::runtime_error("session did not start with HELLO");
+        // any realm is accepted, there is only one
+        peer->joined = true;
+        FrameBuffer frame;
+        Packer packer(frame);
+        packer.pack_array(3);
+        packer.pack(WELCOME);
+        packer.pack(nextId());
+        packer.pack_map(1);
+        packer.pack(std::string("roles"));
+        packer.pack_map(2);
+        packer.pack(std::string("broker"));
+        packer.pack_map(0);
+        packer.pack(std::string("dealer"));
+        packer.pack_map(1);
+        packer.pack(std::string("features"));
+        packFlag(packer, "progressive_call_results", true);
+        peer->send(frame.finish());
+        return;
+    }
+
+    switch (type) {
+    case GOODBYE: {
+        leave(peer);
+        peer->joined = false;
+        FrameBuffer frame;
+        Packer packer(frame);
+        packer.pack_array(3);
+        packer.pack(GOODBYE);
+        packer.pack_map(0);
+        packer.pack(std::string("wamp.close.goodbye_and_out"));
+        peer->send(frame.finish());
+        break;
+    }
+    case PUBLISH:
+        publish(peer, fields, size);
+        break;
+    case SUBSCRIBE:
+        subscribe(peer, fields, size);
+        break;
+    case UNSUBSCRIBE:
+        unsubscribe(peer, fields, size);
+        break;
+    case REGISTER:
+        registerProcedure(peer, fields, size);
+        break;
+    case UNREGISTER:
+        unregisterProcedure(peer, fields, size);
+        break;
+    case CALL:
+        call(peer, fields, size);
+        break;
+    case YIELD:
+        yield(peer, fields, size);
+        break;
+    case ERROR:
+        forwardError(peer, fields, size);
+        break;
+    default:
+        // e.g. CANCEL, not part of what the interface uses
+        break;
+    }
+}
+
+void LocalRouter::publish(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size) {
+    require(size, 4);
+    uint64_t request = fields[1].as<uint64_t>();
+    const msgpack::object& options = fields[2];
+    uint64_t publication = nextId();
+
+    auto it = subscriptions.find(fields[3].as<std::string>());
+    if (it != subscriptions.end()) {
+        bool excludeMe = getOption(options, "exclude_me", true);
+        FrameBuffer frame;
+        Packer packer(frame);
+        packer.pack_array(size);
+        packer.pack(EVENT);
+        packer.pack(it->second.id);
+        packer.pack(publication);
+        packer.pack_map(0);
+        packTail(packer, fields, size, 4);
+        // serialized once for all subscribers
+        Frame event = frame.finish();
+        for (const std::shared_ptr<Peer>& subscriber : it->second.subscribers) {
+            if (subscriber != peer || !excludeMe)
+                subscriber->send(event);
+        }
+    }
+
+    if (getOption(options, "acknowledge", false))
+        peer->send(makeAcknowledgement(PUBLISHED, request, &publication));
+}
+
+void LocalRouter::subscribe(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size) {
+    require(size, 4);
+    uint64_t request = fields[1].as<uint64_t>();
+    std::string match = getStringOption(fields[2], "match");
+    if (!match.empty() && match != "exact") {
+        peer->send(makeError(SUBSCRIBE, request, "wamp.error.invalid_argument"));
+        return;
+    }
+
+    std::string topic = fields[3].as<std::string>();
+    Subscription& subscription = subscriptions[topic];
+    if (subscription.subscribers.empty()) {
+        subscription.id = nextId();
+        subscriptionTopics[subscription.id] = topic;
+    }
+    subscription.subscribers.insert(peer);
+    peer->send(makeAcknowledgement(SUBSCRIBED, request, &subscription.id));
+}
+
+void LocalRouter::unsubscribe(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size) {
+    require(size, 3);
+    uint64_t request = fields[1].as<uint64_t>();
+    auto topic = subscriptionTopics.find(fields[2].as<uint64_t>());
+    if (topic == subscriptionTopics.end() || subscriptions[topic->second].subscribers.erase(peer) == 0) {
+        peer->send(makeError(UNSUBSCRIBE, request, "wamp.error.no_such_subscription"));
+        return;
+    }
+
+    if (subscriptions[topic->second].subscribers.empty()) {
+        subscriptions.erase(topic->second);
+        subscriptionTopics.erase(topic);
+    }
+    peer->send(makeAcknowledgement(UNSUBSCRIBED, request));
+}
+
+void LocalRouter::registerProcedure(const std::shared_ptr<Peer>& peer, const msgpack::object *fields,
+        uint32_t size) {
+    require(size, 4);
+    uint64_t request = fields[1].as<uint64_t>();
+    std::string procedure = fields[3].as<std::string>();
+    if (registrations.count(procedure) > 0) {
+        peer->send(makeError(REGISTER, request, "wamp.error.procedure_already_exists"));
+        return;
+    }
+
+    Registration& registration = registrations[procedure];
+    registration.id = nextId();
+    registration.callee = peer;
+    registrationProcedures[registration.id] = procedure;
+    peer->send(makeAcknowledgement(REGISTERED, request, &registration.id));
+}
+
+void LocalRouter::unregisterProcedure(const std::shared_ptr<Peer>& peer, const msgpack::object *fields,
+        uint32_t size) {
+    require(size, 3);
+    uint64_t request = fields[1].as<uint64_t>();
+    auto procedure = registrationProcedures.find(fields[2].as<uint64_t>());
+    if (procedure == registrationProcedures.end() || registrations[procedure->second].callee != peer) {
+        peer->send(makeError(UNREGISTER, request, "wamp.error.no_such_registration"));
+        return;
+    }
+
+    registrations.erase(procedure->second);
+    registrationProcedures.erase(procedure);
+    peer->send(makeAcknowledgement(UNREGISTERED, request));
+}
+
+void LocalRouter::call(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size) {
+    require(size, 4);
+    uint64_t request = fields[1].as<uint64_t>();
+    auto registration = registrations.find(fields[3].as<std::string>());
+    if (registration == registrations.end()) {
+        peer->send(makeError(CALL, request, "wamp.error.no_such_procedure"));
+        return;
+    }
+
+    uint64_t id = nextId();
+    Invocation& invocation = invocations[id];
+    invocation.caller = peer;
+    invocation.callRequest = request;
+    invocation.callee = registration->second.callee;
+
+    FrameBuffer frame;
+    Packer packer(frame);
+    packer.pack_array(size);
+    packer.pack(INVOCATION);
+    packer.pack(id);
+    packer.pack(registration->second.id);
+    packFlag(packer, "receive_progress", getOption(fields[2], "receive_progress", false));
+    packTail(packer, fields, size, 4);
+    invocation.callee->send(frame.finish());
+}
+
+void LocalRouter::yield(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size) {
+    require(size, 3);
+    auto invocation = invocations.find(fields[1].as<uint64_t>());
+    if (invocation == invocations.end() || invocation->second.callee != peer) {
+        // the caller is gone
+        return;
+    }
+
+    bool progress = getOption(fields[2], "progress", false);
+    FrameBuffer frame;
+    Packer packer(frame);
+    packer.pack_array(size);
+    packer.pack(RESULT);
+    packer.pack(invocation->second.callRequest);
+    packFlag(packer, "progress", progress);
+    packTail(packer, fields, size, 3);
+    invocation->second.caller->send(frame.finish());
+
+    if (!progress)
+        invocations.erase(invocation);
+}
+
+void LocalRouter::forwardError(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size) {
+    require(size, 5);
+    if (fields[1].as<uint64_t>() != INVOCATION)
+        return;
+    auto invocation = invocations.find(fields[2].as<uint64_t>());
+    if (invocation == invocations.end() || invocation->second.callee != peer)
+        return;
+
+    FrameBuffer frame;
+    Packer packer(frame);
+    packer.pack_array(size);
+    packer.pack(ERROR);
+    packer.pack(CALL);
+    packer.pack(invocation->second.callRequest);
+    packTail(packer, fields, size, 3);
+    invocation->second.caller->send(frame.finish());
+    invocations.erase(invocation);
+}
+
+void LocalRouter::leave(const std::shared_ptr<Peer>& peer) {
+    for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+        it->second.subscribers.erase(peer);
+        if (it->second.subscribers.empty()) {
+            subscriptionTopics.erase(it->second.id);
+            it = subscriptions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto it = registrations.begin(); it != registrations.end();) {
+        if (it->second.callee == peer) {
+            registrationProcedures.erase(it->second.id);
+            it = registrations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto it = invocations.begin(); it != invocations.end();) {
+        if (it->second.callee == peer && it->second.caller != peer)
+            it->second.caller->send(makeError(CALL, it->second.callRequest, "wamp.error.canceled"));
+        if (it->second.callee == peer || it->second.caller == peer)
+            it = invocations.erase(it);
+        else
+            ++it;
+    }
+}
+
+void LocalRouter::detach(const std::shared_ptr<Peer>& peer) {
+    leave(peer);
+    peers.erase(peer);
+}
+
+} /* namespace wampinterfaceforomnetpp */
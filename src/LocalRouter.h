@@ -0,0 +1,176 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef LOCALROUTER_H_
+#define LOCALROUTER_H_
+
+#include <boost/asio/basic_socket_acceptor.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/io_service.hpp>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <autobahn/autobahn.hpp>
+
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Minimal WAMP router that runs in the simulation process, a stand-in for Crossbar.io
+ * where none is available, e.g. for the benchmarks in simulations/benchmark.
+ * Enabled with the ini option wamp-local-router.
+ *
+ * It accepts rawsocket connections with the msgpack serializer on the endpoint the
+ * sessions connect to and implements as much of the WAMP basic profile as the interface
+ * uses: any realm name, subscribe and publish with exact topic matching, register and
+ * call with a single callee per procedure and progressive call results. There is no
+ * meta API, authentication or pattern based subscription, so wamp-demand-driven
+ * falls back to publishing all topics.
+ *
+ * All routing happens on the own I/O thread of the router.
+ */
+class LocalRouter {
+public:
+    LocalRouter();
+
+    /**
+     * Stops the router.
+     */
+    ~LocalRouter();
+
+    /**
+     * Sets the endpoint to listen on, with the same meaning as for WAMPConnection::configure().
+     * Used from the next start() on.
+     */
+    void configure(WAMPConnection::Transport transport, const std::string& host, uint16_t port,
+            const std::string& udsPath);
+
+    /**
+     * Binds the endpoint and starts routing on the I/O thread.
+     * Throws a std::exception if the endpoint cannot be bound.
+     */
+    void start();
+
+    /**
+     * Closes all connections and waits for the I/O thread.
+     */
+    void stop();
+
+    bool isRunning() const {
+        return running;
+    }
+
+    /**
+     * Number of WAMP messages received since start(), read on any thread.
+     */
+    uint64_t getReceived() const {
+        return received.load(std::memory_order_relaxed);
+    }
+
+private:
+    class Peer;
+    friend class Peer;
+
+    typedef boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> Acceptor;
+
+    /**
+     * Subscribers of a topic.
+     */
+    struct Subscription {
+        uint64_t id;
+        std::set<std::shared_ptr<Peer>> subscribers;
+    };
+
+    /**
+     * Callee of a procedure.
+     */
+    struct Registration {
+        uint64_t id;
+        std::shared_ptr<Peer> callee;
+    };
+
+    /**
+     * A call that was forwarded to its callee and waits for the result.
+     */
+    struct Invocation {
+        std::shared_ptr<Peer> caller;
+        uint64_t callRequest;
+        std::shared_ptr<Peer> callee;
+    };
+
+    void accept();
+
+    /**
+     * Routes a message received from the peer.
+     */
+    void route(const std::shared_ptr<Peer>& peer, const msgpack::object& message);
+
+    void publish(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void subscribe(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void unsubscribe(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void registerProcedure(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void unregisterProcedure(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void call(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void yield(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+    void forwardError(const std::shared_ptr<Peer>& peer, const msgpack::object *fields, uint32_t size);
+
+    /**
+     * Removes the subscriptions and registrations of the peer, and fails the calls it was invoked for.
+     */
+    void leave(const std::shared_ptr<Peer>& peer);
+
+    /**
+     * Removes the peer after its connection was closed.
+     */
+    void detach(const std::shared_ptr<Peer>& peer);
+
+    /**
+     * Returns a new id for sessions, subscriptions, registrations, publications and invocations.
+     */
+    uint64_t nextId() {
+        return ++lastId;
+    }
+
+    WAMPConnection::Transport transport;
+    std::string host;
+    uint16_t port;
+    std::string udsPath;
+
+    boost::asio::io_service io;
+    std::unique_ptr<Acceptor> acceptor;
+    std::thread runner;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> received;
+
+    /**
+     * Routing state, only used on the I/O thread.
+     */
+    std::set<std::shared_ptr<Peer>> peers;
+    std::map<std::string, Subscription> subscriptions;
+    std::map<uint64_t, std::string> subscriptionTopics;
+    std::map<std::string, Registration> registrations;
+    std::map<uint64_t, std::string> registrationProcedures;
+    std::map<uint64_t, Invocation> invocations;
+    uint64_t lastId;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* LOCALROUTER_H_ */
@@ -0,0 +1,144 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ModuleIndex.h"
+
+#include <utility>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Number of compiled selectors kept by a ModuleIndex.
+ */
+static const size_t MAX_SELECTORS = 1024;
+
+ModuleIndex::ModuleIndex() :
+        root(nullptr) {
+}
+
+ModuleIndex::~ModuleIndex() {
+    clear();
+}
+
+void ModuleIndex::build(omnetpp::cModule *root) {
+    clear();
+    this->root = root;
+    add(root);
+    root->subscribe(omnetpp::PRE_MODEL_CHANGE, this);
+    root->subscribe(omnetpp::POST_MODEL_CHANGE, this);
+}
+
+void ModuleIndex::clear() {
+    if (root != nullptr) {
+        root->unsubscribe(omnetpp::PRE_MODEL_CHANGE, this);
+        root->unsubscribe(omnetpp::POST_MODEL_CHANGE, this);
+        root = nullptr;
+    }
+    modules.clear();
+    arrays.clear();
+}
+
+omnetpp::cModule* ModuleIndex::find(const std::string& path) const {
+    auto it = modules.find(path);
+    return it != modules.end() ? it->second : nullptr;
+}
+
+const std::vector<omnetpp::cModule*>* ModuleIndex::findArray(const std::string& prefix) const {
+    auto it = arrays.find(prefix);
+    return it != arrays.end() ? &it->second : nullptr;
+}
+
+void ModuleIndex::resolve(const std::string& selector, std::vector<omnetpp::cModule*>& result) const {
+    getSelector(selector)->select(*this, result);
+}
+
+std::shared_ptr<const ModuleSelector> ModuleIndex::getSelector(const std::string& selector) const {
+    auto it = selectors.find(selector);
+    if (it != selectors.end()) {
+        selectorUses.splice(selectorUses.begin(), selectorUses, it->second.use);
+        return it->second.selector;
+    }
+
+    // parsed first, a malformed selector leaves the cache as it is
+    std::shared_ptr<const ModuleSelector> compiled = std::make_shared<ModuleSelector>(selector);
+    if (selectors.size() >= MAX_SELECTORS) {
+        selectors.erase(selectorUses.back());
+        selectorUses.pop_back();
+    }
+    selectorUses.push_front(selector);
+    CachedSelector& cached = selectors[selector];
+    cached.selector = compiled;
+    cached.use = selectorUses.begin();
+    return compiled;
+}
+
+void ModuleIndex::receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID, omnetpp::cObject *obj,
+        omnetpp::cObject *details) {
+    if (signalID == omnetpp::POST_MODEL_CHANGE) {
+        if (auto added = dynamic_cast<omnetpp::cPostModuleAddNotification*>(obj))
+            add(added->module);
+        else if (auto reparented = dynamic_cast<omnetpp::cPostModuleReparentNotification*>(obj))
+            add(reparented->module);
+    } else if (signalID == omnetpp::PRE_MODEL_CHANGE) {
+        if (auto deleted = dynamic_cast<omnetpp::cPreModuleDeleteNotification*>(obj))
+            remove(deleted->module);
+        else if (auto reparented = dynamic_cast<omnetpp::cPreModuleReparentNotification*>(obj))
+            remove(reparented->module);
+    }
+}
+
+void ModuleIndex::add(omnetpp::cModule *module) {
+    // under parallel simulation the modules of other partitions are placeholders
+    if (module->isPlaceholder())
+        return;
+    modules[module->getFullPath()] = module;
+    if (module->isVector()) {
+        std::vector<omnetpp::cModule*>& elements = arrays[arrayKey(module)];
+        if (elements.size() <= (size_t) module->getIndex())
+            elements.resize(module->getIndex() + 1, nullptr);
+        elements[module->getIndex()] = module;
+    }
+
+    for (omnetpp::cModule::SubmoduleIterator it(module); !it.end(); ++it)
+        add(*it);
+}
+
+void ModuleIndex::remove(omnetpp::cModule *module) {
+    for (omnetpp::cModule::SubmoduleIterator it(module); !it.end(); ++it)
+        remove(*it);
+
+    modules.erase(module->getFullPath());
+    if (module->isVector()) {
+        auto it = arrays.find(arrayKey(module));
+        if (it == arrays.end())
+            return;
+        std::vector<omnetpp::cModule*>& elements = it->second;
+        if ((size_t) module->getIndex() < elements.size() && elements[module->getIndex()] == module)
+            elements[module->getIndex()] = nullptr;
+        while (!elements.empty() && elements.back() == nullptr)
+            elements.pop_back();
+        if (elements.empty())
+            arrays.erase(it);
+    }
+}
+
+std::string ModuleIndex::arrayKey(omnetpp::cModule *module) {
+    omnetpp::cModule *parent = module->getParentModule();
+    if (parent == nullptr)
+        return module->getName();
+    return parent->getFullPath() + "." + module->getName();
+}
+
+} /* namespace wampinterfaceforomnetpp */
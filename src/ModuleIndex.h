@@ -0,0 +1,130 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MODULEINDEX_H_
+#define MODULEINDEX_H_
+
+#include <omnetpp.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ModuleSelector.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Index from full module paths and module vector prefixes to the modules of the network.
+ *
+ * Built once after network setup and kept current through the model change
+ * notifications of the system module, so resolving a path of the remote procedures
+ * costs a hash lookup instead of a walk over the module tree. Placeholders of modules
+ * in other partitions of a parallel simulation are not indexed. Only used on the
+ * simulation thread.
+ */
+class ModuleIndex: public omnetpp::cListener {
+public:
+    ModuleIndex();
+    virtual ~ModuleIndex();
+
+    /**
+     * Indexes all modules below and including root and follows its model changes.
+     */
+    void build(omnetpp::cModule *root);
+
+    /**
+     * Stops following the model changes and forgets all modules.
+     */
+    void clear();
+
+    /**
+     * Returns the module with the given full path, nullptr if there is none.
+     */
+    omnetpp::cModule* find(const std::string& path) const;
+
+    /**
+     * Returns the elements of the module vector with the given prefix (e.g. "net.host"),
+     * ordered by index. Missing elements are nullptr. Returns nullptr if there is no such vector.
+     */
+    const std::vector<omnetpp::cModule*>* findArray(const std::string& prefix) const;
+
+    omnetpp::cModule* getRoot() const {
+        return root;
+    }
+
+    /**
+     * Adds all modules addressed by the ModuleSelector to the list. The compiled selector
+     * is cached, so repeated requests with the same path are not parsed again.
+     * Throws a cRuntimeError if the selector is malformed.
+     */
+    void resolve(const std::string& selector, std::vector<omnetpp::cModule*>& result) const;
+
+    /**
+     * Returns the compiled selector, parsing it on first use. It stays valid for its holder
+     * after it was evicted from the cache.
+     */
+    std::shared_ptr<const ModuleSelector> getSelector(const std::string& selector) const;
+
+    /**
+     * Updates the index on module creation, deletion and reparenting.
+     */
+    virtual void receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID, omnetpp::cObject *obj,
+            omnetpp::cObject *details) override;
+
+private:
+    /**
+     * Adds the module and its submodules.
+     */
+    void add(omnetpp::cModule *module);
+
+    /**
+     * Removes the module and its submodules.
+     */
+    void remove(omnetpp::cModule *module);
+
+    /**
+     * Key of the vector a module belongs to, the full path without index.
+     */
+    static std::string arrayKey(omnetpp::cModule *module);
+
+    omnetpp::cModule *root;
+    std::unordered_map<std::string, omnetpp::cModule*> modules;
+    std::unordered_map<std::string, std::vector<omnetpp::cModule*>> arrays;
+
+    /**
+     * A compiled selector and its place in the usage order.
+     */
+    struct CachedSelector {
+        std::shared_ptr<const ModuleSelector> selector;
+        std::list<std::string>::iterator use;
+    };
+
+    /**
+     * Compiled selectors by their text. Clients may send any number of different paths,
+     * so beyond a limit the least recently used one is evicted.
+     */
+    mutable std::unordered_map<std::string, CachedSelector> selectors;
+
+    /**
+     * Texts of the cached selectors, the most recently used first.
+     */
+    mutable std::list<std::string> selectorUses;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* MODULEINDEX_H_ */
@@ -0,0 +1,220 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ModuleSelector.h"
+
+#include <climits>
+#include <cstring>
+#include <unordered_set>
+
+#include "ModuleIndex.h"
+
+namespace wampinterfaceforomnetpp {
+
+ModuleSelector::ModuleSelector(const std::string& selector) :
+        recursive(false) {
+    // dots inside brackets belong to index ranges
+    size_t start = 0;
+    int depth = 0;
+    for (size_t i = 0; i <= selector.size(); ++i) {
+        if (i == selector.size() || (selector[i] == '.' && depth == 0)) {
+            segments.push_back(parseSegment(selector.substr(start, i - start), selector));
+            start = i + 1;
+        } else if (selector[i] == '[') {
+            depth++;
+        } else if (selector[i] == ']') {
+            depth--;
+        }
+    }
+
+    for (auto& segment : segments)
+        recursive |= segment.kind == Segment::RECURSIVE;
+}
+
+ModuleSelector::Segment ModuleSelector::parseSegment(const std::string& text, const std::string& selector) {
+    Segment segment;
+    segment.range = Segment::SCALAR;
+    segment.from = 0;
+    segment.to = INT_MAX;
+
+    if (text == "**") {
+        segment.kind = Segment::RECURSIVE;
+        return segment;
+    }
+
+    size_t bracket = text.find('[');
+    segment.name = text.substr(0, bracket);
+    if (segment.name.empty())
+        throw omnetpp::cRuntimeError("Empty segment in module selector \"%s\"", selector.c_str());
+    segment.kind = segment.name.find_first_of("*?") != std::string::npos ? Segment::GLOB : Segment::LITERAL;
+    if (bracket == std::string::npos)
+        return segment;
+
+    if (text.back() != ']')
+        throw omnetpp::cRuntimeError("Missing ] in module selector \"%s\"", selector.c_str());
+    std::string range = text.substr(bracket + 1, text.size() - bracket - 2);
+    if (range == "*") {
+        segment.range = Segment::ALL;
+        return segment;
+    }
+
+    segment.range = Segment::INDEX;
+    size_t dots = range.find("..");
+    std::string from = dots == std::string::npos ? range : range.substr(0, dots);
+    std::string to = dots == std::string::npos ? range : range.substr(dots + 2);
+    if ((dots == std::string::npos && range.empty())
+            || from.find_first_not_of("0123456789") != std::string::npos
+            || to.find_first_not_of("0123456789") != std::string::npos)
+        throw omnetpp::cRuntimeError("Invalid index \"%s\" in module selector \"%s\"", range.c_str(),
+                selector.c_str());
+    if (!from.empty())
+        segment.from = std::stoi(from);
+    if (!to.empty())
+        segment.to = std::stoi(to);
+    return segment;
+}
+
+void ModuleSelector::select(const ModuleIndex& index, std::vector<omnetpp::cModule*>& result) const {
+    omnetpp::cModule *root = index.getRoot();
+    if (root == nullptr)
+        return;
+
+    size_t first = result.size();
+    selectModule(index, 0, root, root->getFullName(), result);
+
+    // ** can reach a module on several ways
+    if (recursive) {
+        std::unordered_set<omnetpp::cModule*> seen;
+        size_t kept = first;
+        for (size_t i = first; i < result.size(); ++i) {
+            if (seen.insert(result[i]).second)
+                result[kept++] = result[i];
+        }
+        result.resize(kept);
+    }
+}
+
+bool ModuleSelector::matches(omnetpp::cModule *module) const {
+    return matchesUpTo(segments.size(), module);
+}
+
+bool ModuleSelector::isPath(const std::string& selector) {
+    return selector.find_first_of("*?") == std::string::npos && selector.find("..") == std::string::npos;
+}
+
+bool ModuleSelector::matchesUpTo(size_t segment, omnetpp::cModule *module) const {
+    if (segment == 0)
+        return module == nullptr;
+
+    const Segment& last = segments[segment - 1];
+    if (last.kind == Segment::RECURSIVE) {
+        // either no more levels or the module is one of them
+        return matchesUpTo(segment - 1, module)
+                || (module != nullptr && matchesUpTo(segment, module->getParentModule()));
+    }
+    return module != nullptr && matchesSegment(last, module) && matchesUpTo(segment - 1, module->getParentModule());
+}
+
+void ModuleSelector::selectModule(const ModuleIndex& index, size_t segment, omnetpp::cModule *module,
+        const std::string& path, std::vector<omnetpp::cModule*>& result) const {
+    if (segment == segments.size())
+        return;
+
+    const Segment& current = segments[segment];
+    if (current.kind == Segment::RECURSIVE) {
+        selectModule(index, segment + 1, module, path, result);
+        selectBelow(index, segment, module, path, result);
+    } else if (matchesSegment(current, module)) {
+        selectBelow(index, segment + 1, module, path, result);
+    }
+}
+
+void ModuleSelector::selectBelow(const ModuleIndex& index, size_t segment, omnetpp::cModule *module,
+        const std::string& path, std::vector<omnetpp::cModule*>& result) const {
+    if (segment == segments.size()) {
+        result.push_back(module);
+        return;
+    }
+
+    const Segment& next = segments[segment];
+    if (next.kind == Segment::RECURSIVE) {
+        selectBelow(index, segment + 1, module, path, result);
+        for (omnetpp::cModule::SubmoduleIterator it(module); !it.end(); ++it)
+            selectBelow(index, segment, *it, path + "." + (*it)->getFullName(), result);
+    } else if (next.kind == Segment::GLOB) {
+        for (omnetpp::cModule::SubmoduleIterator it(module); !it.end(); ++it) {
+            if (matchesSegment(next, *it))
+                selectBelow(index, segment + 1, *it, path + "." + (*it)->getFullName(), result);
+        }
+    } else if (next.range == Segment::SCALAR) {
+        std::string childPath = path + "." + next.name;
+        omnetpp::cModule *child = index.find(childPath);
+        if (child != nullptr)
+            selectBelow(index, segment + 1, child, childPath, result);
+    } else {
+        // only the elements in range are visited
+        std::string prefix = path + "." + next.name;
+        const std::vector<omnetpp::cModule*> *elements = index.findArray(prefix);
+        if (elements == nullptr)
+            return;
+        int to = std::min<long>(next.to, (long) elements->size() - 1);
+        for (int i = next.from; i <= to; ++i) {
+            omnetpp::cModule *element = (*elements)[i];
+            if (element != nullptr)
+                selectBelow(index, segment + 1, element, prefix + "[" + std::to_string(i) + "]", result);
+        }
+    }
+}
+
+bool ModuleSelector::matchesSegment(const Segment& segment, omnetpp::cModule *module) {
+    bool nameMatches = segment.kind == Segment::GLOB ?
+            matchesGlob(segment.name.c_str(), module->getName()) : segment.name == module->getName();
+    if (!nameMatches)
+        return false;
+
+    switch (segment.range) {
+    case Segment::SCALAR:
+        return segment.kind == Segment::GLOB || !module->isVector();
+    case Segment::ALL:
+        return module->isVector();
+    default:
+        return module->isVector() && module->getIndex() >= segment.from && module->getIndex() <= segment.to;
+    }
+}
+
+bool ModuleSelector::matchesGlob(const char *pattern, const char *name) {
+    // iterative matching with backtracking to the last *
+    const char *star = nullptr;
+    const char *resume = nullptr;
+    while (*name != '\0') {
+        if (*pattern == '?' || *pattern == *name) {
+            pattern++;
+            name++;
+        } else if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (star != nullptr) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+
+} /* namespace wampinterfaceforomnetpp */
@@ -0,0 +1,122 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MODULESELECTOR_H_
+#define MODULESELECTOR_H_
+
+#include <omnetpp.h>
+#include <string>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+class ModuleIndex;
+
+/**
+ * Compiled module selector, e.g. "net.host[0..499].app[*].*".
+ *
+ * A selector is a dot separated list of segments, each of which matches one level
+ * of the module tree:
+ *  - name          the submodule of that name
+ *  - name[3]       the element with index 3 of the module vector
+ *  - name[0..499]  the elements of the index range, either end may be left out
+ *  - name[*]       all elements of the module vector
+ *  - glob          names with * and ? wildcards, e.g. * or host*, match submodules and vector elements;
+ *                  glob[...] only matches vector elements
+ *  - **            any number of levels, including none
+ * The first segment matches the system module.
+ *
+ * Selectors are parsed once. Literal segments are resolved through the ModuleIndex,
+ * so only the subtrees that can match are visited.
+ */
+class ModuleSelector {
+public:
+    /**
+     * Parses the selector. Throws a cRuntimeError if it is malformed.
+     */
+    explicit ModuleSelector(const std::string& selector);
+
+    /**
+     * Adds the modules of the indexed tree that match the selector to the list, each once.
+     */
+    void select(const ModuleIndex& index, std::vector<omnetpp::cModule*>& result) const;
+
+    /**
+     * Returns whether the module matches the selector.
+     */
+    bool matches(omnetpp::cModule *module) const;
+
+    /**
+     * Returns whether the selector is a plain module path without wildcards or index ranges,
+     * i.e. addresses at most one module.
+     */
+    static bool isPath(const std::string& selector);
+
+private:
+    struct Segment {
+        enum Kind {
+            LITERAL, GLOB, RECURSIVE
+        };
+
+        enum Range {
+            SCALAR, ALL, INDEX
+        };
+
+        Kind kind;
+        std::string name;
+        Range range;
+        int from;
+        int to;
+    };
+
+    /**
+     * Parses one segment, e.g. "host[0..499]".
+     */
+    static Segment parseSegment(const std::string& text, const std::string& selector);
+
+    /**
+     * Whether the name and index of the module match the segment.
+     */
+    static bool matchesSegment(const Segment& segment, omnetpp::cModule *module);
+
+    /**
+     * Matches name against a pattern with * and ? wildcards.
+     */
+    static bool matchesGlob(const char *pattern, const char *name);
+
+    /**
+     * Continues with a module that was reached for the given segment.
+     */
+    void selectModule(const ModuleIndex& index, size_t segment, omnetpp::cModule *module, const std::string& path,
+            std::vector<omnetpp::cModule*>& result) const;
+
+    /**
+     * Expands the submodules of a module that matched all segments before the given one.
+     */
+    void selectBelow(const ModuleIndex& index, size_t segment, omnetpp::cModule *module, const std::string& path,
+            std::vector<omnetpp::cModule*>& result) const;
+
+    /**
+     * Matches the ancestors of a module against the segments up to the given one, from the back.
+     */
+    bool matchesUpTo(size_t segment, omnetpp::cModule *module) const;
+
+    std::vector<Segment> segments;
+    bool recursive;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* MODULESELECTOR_H_ */
@@ -0,0 +1,75 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ParameterQueue.h"
+
+namespace wampinterfaceforomnetpp {
+
+ParameterQueue::ParameterQueue() :
+        coalesced(0) {
+}
+
+void ParameterQueue::push(const std::string& moduleName, const std::string& paramName, const std::string& value,
+        autobahn::wamp_invocation invocation, std::chrono::steady_clock::time_point arrival) {
+    std::pair<std::string, std::string> key(moduleName, paramName);
+    auto position = positions.find(key);
+    if (position != positions.end()) {
+        Entry *entry = queued[position->second];
+        queued[position->second] = nullptr;
+        entry->msg.value = value;
+        entry->invocations.push_back(invocation);
+        entry->arrivals.push_back(arrival);
+        position->second = queued.size();
+        queued.push_back(entry);
+        coalesced++;
+        return;
+    }
+
+    Entry *entry;
+    if (pool.empty()) {
+        entries.push_back(std::unique_ptr<Entry>(new Entry()));
+        entry = entries.back().get();
+    } else {
+        entry = pool.back();
+        pool.pop_back();
+    }
+    entry->msg.moduleName = moduleName;
+    entry->msg.paramName = paramName;
+    entry->msg.value = value;
+    entry->invocations.push_back(invocation);
+    entry->arrivals.push_back(arrival);
+    positions.insert(std::make_pair(key, queued.size()));
+    queued.push_back(entry);
+}
+
+void ParameterQueue::take(std::vector<Entry*>& batch) {
+    for (Entry *entry : queued) {
+        if (entry != nullptr)
+            batch.push_back(entry);
+    }
+    queued.clear();
+    positions.clear();
+}
+
+void ParameterQueue::recycle(std::vector<Entry*>& batch) {
+    for (Entry *entry : batch) {
+        entry->invocations.clear();
+        entry->arrivals.clear();
+        pool.push_back(entry);
+    }
+    batch.clear();
+}
+
+} /* namespace wampinterfaceforomnetpp */
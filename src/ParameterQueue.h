@@ -0,0 +1,108 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef PARAMETERQUEUE_H_
+#define PARAMETERQUEUE_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <autobahn/autobahn.hpp>
+
+#include "ParameterMsg.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Parameter writes of setParameter that wait to be applied on the simulation thread.
+ *
+ * A write to a (module, parameter) that is already queued supersedes the queued write: the
+ * entry takes the newer value, remembers all invocations to answer and moves to the position
+ * of the newer write, so only the last value is applied and writes to other parameters keep
+ * their order. Writes are only merged until the queue is taken, which happens before every
+ * other request, so they never move across requests. Entries come from a pool and are handed
+ * back after they were applied, so their strings keep their capacity. Only used on the
+ * simulation thread.
+ */
+class ParameterQueue {
+public:
+    /**
+     * A queued write and the invocations that asked for it.
+     */
+    struct Entry {
+        ParameterMsg msg;
+        std::vector<autobahn::wamp_invocation> invocations;
+
+        /**
+         * When each of the invocations arrived, for the BridgeMetrics.
+         */
+        std::vector<std::chrono::steady_clock::time_point> arrivals;
+    };
+
+    ParameterQueue();
+
+    /**
+     * Queues a write, superseding a queued write to the same parameter.
+     */
+    void push(const std::string& moduleName, const std::string& paramName, const std::string& value,
+            autobahn::wamp_invocation invocation, std::chrono::steady_clock::time_point arrival);
+
+    /**
+     * Moves the queued entries into the empty batch, in the order they were queued, and starts
+     * a new generation of writes that may be merged.
+     */
+    void take(std::vector<Entry*>& batch);
+
+    /**
+     * Hands the entries of a processed batch back to the pool and clears the batch.
+     */
+    void recycle(std::vector<Entry*>& batch);
+
+    bool isEmpty() const {
+        return queued.empty();
+    }
+
+    /**
+     * Number of writes that were merged into a queued one.
+     */
+    unsigned long getCoalesced() const {
+        return coalesced;
+    }
+
+private:
+    /**
+     * Superseded writes leave a null behind, take() skips them.
+     */
+    std::vector<Entry*> queued;
+
+    /**
+     * Position in queued of the write to each (module, parameter) since the last take().
+     */
+    std::map<std::pair<std::string, std::string>, size_t> positions;
+
+    /**
+     * Owns all entries, free ones are listed in pool.
+     */
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<Entry*> pool;
+
+    unsigned long coalesced;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* PARAMETERQUEUE_H_ */
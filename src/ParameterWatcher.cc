@@ -0,0 +1,138 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ParameterWatcher.h"
+
+#include <tuple>
+
+#include "LiveValue.h"
+
+namespace wampinterfaceforomnetpp {
+
+ParameterWatcher::ParameterWatcher() :
+        root(nullptr), index(nullptr), connection(nullptr), subscribed(false), nextId(0) {
+}
+
+ParameterWatcher::~ParameterWatcher() {
+    stop();
+}
+
+void ParameterWatcher::start(omnetpp::cModule *root, const ModuleIndex *index, WAMPConnection *connection,
+        const std::string& topic) {
+    stop();
+    this->root = root;
+    this->index = index;
+    this->connection = connection;
+    this->topic = topic;
+}
+
+void ParameterWatcher::stop() {
+    watches.clear();
+    updateSubscription();
+    root = nullptr;
+    index = nullptr;
+    connection = nullptr;
+}
+
+long ParameterWatcher::watch(const std::string& selector, const std::string& parameter) {
+    Watch watch;
+    watch.id = nextId++;
+    watch.selector = index->getSelector(selector);
+    watch.parameter = parameter;
+    watches.push_back(watch);
+    updateSubscription();
+    return watch.id;
+}
+
+bool ParameterWatcher::unwatch(long id) {
+    for (auto it = watches.begin(); it != watches.end(); ++it) {
+        if (it->id == id) {
+            watches.erase(it);
+            updateSubscription();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ParameterWatcher::updateSubscription() {
+    bool needed = root != nullptr && !watches.empty();
+    if (needed == subscribed)
+        return;
+    if (needed)
+        root->subscribe(omnetpp::POST_MODEL_CHANGE, this);
+    else
+        root->unsubscribe(omnetpp::POST_MODEL_CHANGE, this);
+    subscribed = needed;
+}
+
+void ParameterWatcher::receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID,
+        omnetpp::cObject *obj, omnetpp::cObject *details) {
+    auto change = dynamic_cast<omnetpp::cPostParameterChangeNotification*>(obj);
+    if (change == nullptr)
+        return;
+
+    omnetpp::cPar *par = change->par;
+    omnetpp::cComponent *owner = par->getOwnerComponent();
+    if (owner == nullptr || !owner->isModule())
+        return;
+    omnetpp::cModule *module = static_cast<omnetpp::cModule*>(owner);
+
+    for (auto& watch : watches) {
+        if ((watch.parameter == "*" || watch.parameter == par->getName()) && watch.selector->matches(module))
+            publish(watch, module, par);
+    }
+}
+
+void ParameterWatcher::publish(const Watch& watch, omnetpp::cModule *module, omnetpp::cPar *par) {
+    if (connection == nullptr)
+        return;
+
+    LiveValue value;
+    if (par->isExpression()) {
+        // evaluating volatile expressions would draw random numbers
+        value.kind = LiveValue::STRING;
+        value.s = "=" + par->str();
+    } else {
+        switch (par->getType()) {
+        case omnetpp::cPar::BOOL:
+            value.kind = LiveValue::BOOL;
+            value.b = par->boolValue();
+            break;
+        case omnetpp::cPar::LONG:
+            value.kind = LiveValue::LONG;
+            value.l = par->longValue();
+            break;
+        case omnetpp::cPar::DOUBLE:
+            value.kind = LiveValue::DOUBLE;
+            value.d = par->doubleValue();
+            break;
+        default:
+            value.kind = LiveValue::STRING;
+            value.s = par->str();
+            break;
+        }
+    }
+
+    std::tuple<int64_t, int, long, std::string, std::string, LiveValue> arguments(omnetpp::simTime().raw(),
+            omnetpp::SimTime::getScaleExp(), watch.id, module->getFullPath(), par->getName(), value);
+    WAMPConnection *target = connection;
+    std::string uri = topic;
+    connection->post([target, uri, arguments]() {
+        target->publish(uri, arguments);
+    });
+}
+
+} /* namespace wampinterfaceforomnetpp */
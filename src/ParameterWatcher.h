@@ -0,0 +1,98 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef PARAMETERWATCHER_H_
+#define PARAMETERWATCHER_H_
+
+#include <omnetpp.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ModuleIndex.h"
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Publishes an event whenever a watched parameter changes, so clients do not have to poll getParameter.
+ *
+ * A watch is a ModuleSelector, compiled through the ModuleIndex of the callee, and a parameter
+ * name ("*" for all parameters). The watcher follows
+ * the parameter change notifications of the network only while there are watches, so the cost is
+ * proportional to the actual changes. Each event carries
+ * (rawTime, scaleExponent, watchId, modulePath, parameterName, value), the value in its native type.
+ * Only used on the simulation thread, the events are published by the I/O thread.
+ */
+class ParameterWatcher: public omnetpp::cListener {
+public:
+    ParameterWatcher();
+    virtual ~ParameterWatcher();
+
+    /**
+     * @param root          The network whose parameters are watched.
+     * @param index         The index that compiles and caches the selectors of the watches.
+     * @param connection    The connection the events are published on.
+     * @param topic         The topic of the events.
+     */
+    void start(omnetpp::cModule *root, const ModuleIndex *index, WAMPConnection *connection, const std::string& topic);
+
+    /**
+     * Removes all watches.
+     */
+    void stop();
+
+    /**
+     * Adds a watch and returns its id. Throws a cRuntimeError if the selector is malformed.
+     */
+    long watch(const std::string& selector, const std::string& parameter);
+
+    /**
+     * Removes a watch. Returns false if there is no watch with that id.
+     */
+    bool unwatch(long id);
+
+    /**
+     * Publishes the changes of watched parameters.
+     */
+    virtual void receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID, omnetpp::cObject *obj,
+            omnetpp::cObject *details) override;
+
+private:
+    struct Watch {
+        long id;
+        std::shared_ptr<const ModuleSelector> selector;
+        std::string parameter;
+    };
+
+    void publish(const Watch& watch, omnetpp::cModule *module, omnetpp::cPar *par);
+
+    /**
+     * Follows the parameter changes only while there are watches.
+     */
+    void updateSubscription();
+
+    omnetpp::cModule *root;
+    const ModuleIndex *index;
+    WAMPConnection *connection;
+    std::string topic;
+    bool subscribed;
+    std::vector<Watch> watches;
+    long nextId;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* PARAMETERWATCHER_H_ */
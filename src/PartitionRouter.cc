@@ -0,0 +1,175 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "PartitionRouter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "ModuleSelector.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Error of routed invocations that no partition could answer.
+ */
+static const char *ERROR_URI = "wampinterfaceforomnetpp.error.partition_unreachable";
+
+PartitionRouter::PartitionRouter() :
+        partitionId(0), numPartitions(1), connection(nullptr) {
+}
+
+void PartitionRouter::start(WAMPConnection *connection) {
+    this->connection = connection;
+    partitionId = omnetpp::getEnvir()->getParsimProcId();
+    numPartitions = std::max(1, omnetpp::getEnvir()->getParsimNumPartitions());
+}
+
+std::string PartitionRouter::shardUri(const std::string& procedure, int partition) {
+    return procedure + ".partition" + std::to_string(partition);
+}
+
+std::vector<int> PartitionRouter::findPartitions(const std::string& selector, const ModuleIndex& index) const {
+    if (ModuleSelector::isPath(selector)) {
+        // compound modules exist in every partition that has one of their submodules, so only simple ones are local
+        omnetpp::cModule *module = index.find(selector);
+        if (module != nullptr && module->isSimple())
+            return std::vector<int>(1, partitionId);
+
+        // the same option the simulation kernel places the module by
+        const char *value = omnetpp::getEnvir()->getConfigEx()->getPerObjectConfigValue(selector.c_str(),
+                "partition-id");
+        if (module == nullptr && value != nullptr) {
+            char *end;
+            long partition = strtol(value, &end, 10);
+            if (end != value && *end == '\0' && partition >= 0 && partition < numPartitions)
+                return std::vector<int>(1, (int) partition);
+        }
+    }
+
+    std::vector<int> partitions;
+    for (int partition = 0; partition < numPartitions; ++partition)
+        partitions.push_back(partition);
+    return partitions;
+}
+
+void PartitionRouter::forward(autobahn::wamp_invocation invocation, const std::string& procedure,
+        const std::vector<int>& partitions, const std::vector<std::string>& arguments, Merge merge) {
+    // the session is only used on the I/O thread, and every invocation gets a result or an error
+    WAMPConnection *target = connection;
+    target->post([this, target, invocation, procedure, partitions, arguments, merge]() {
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [](const boost::future<void>& continuation) {
+            return continuation.is_ready();
+        }), pending.end());
+
+        if (!target->isJoined()) {
+            invocation->error(ERROR_URI, std::make_tuple(std::string("Not connected to the WAMP router")));
+            return;
+        }
+
+        std::vector<boost::future<autobahn::wamp_call_result>> calls;
+        try {
+            for (int partition : partitions)
+                calls.push_back(target->getSession()->call(shardUri(procedure, partition), arguments));
+        } catch (const std::exception& e) {
+            invocation->error(ERROR_URI, std::make_tuple(std::string(e.what())));
+            return;
+        }
+
+        auto all = boost::when_all(calls.begin(), calls.end());
+        typedef decltype(all) AllCalls;
+        pending.push_back(all.then([target, invocation, merge](AllCalls done) {
+            std::shared_ptr<std::vector<Outcome>> outcomes = std::make_shared<std::vector<Outcome>>();
+            for (auto& call : done.get()) {
+                Outcome outcome;
+                outcome.failed = false;
+                try {
+                    outcome.result = call.get();
+                } catch (const std::exception& e) {
+                    outcome.failed = true;
+                    outcome.error = e.what();
+                }
+                outcomes->push_back(std::move(outcome));
+            }
+            // the continuation may run on any thread, the invocation is answered on the I/O thread
+            target->post([invocation, merge, outcomes]() {
+                try {
+                    reply(invocation, merge, *outcomes);
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                }
+            });
+        }));
+    });
+}
+
+void PartitionRouter::reply(autobahn::wamp_invocation invocation, Merge merge, std::vector<Outcome>& outcomes) {
+    std::string error;
+    for (auto& outcome : outcomes) {
+        if (outcome.failed && error.empty())
+            error = outcome.error;
+    }
+
+    if (merge == SET) {
+        // "\n" is the result of a successful write
+        std::string result;
+        for (auto& outcome : outcomes) {
+            if (outcome.failed || outcome.result.number_of_arguments() == 0)
+                continue;
+            std::string partial = outcome.result.argument<std::string>(0);
+            if (result.empty() || partial == "\n")
+                result = partial;
+            if (result == "\n")
+                break;
+        }
+        if (result.empty())
+            invocation->error(ERROR_URI, std::make_tuple(error.empty() ? std::string("No partition answered") : error));
+        else
+            invocation->result(std::make_tuple(result));
+        return;
+    }
+
+    // partitions without the module answer with a single message instead of values
+    std::vector<msgpack::object> values;
+    std::string notFound;
+    for (auto& outcome : outcomes) {
+        if (outcome.failed)
+            continue;
+        size_t count = outcome.result.number_of_arguments();
+        if (count == 1) {
+            msgpack::object value = outcome.result.argument<msgpack::object>(0);
+            if (value.type == msgpack::type::STR) {
+                std::string text = value.as<std::string>();
+                if (text == "Module not found" || text == "Parameter not found") {
+                    if (notFound.empty())
+                        notFound = text;
+                    continue;
+                }
+            }
+        }
+        for (size_t i = 0; i < count; ++i)
+            values.push_back(outcome.result.argument<msgpack::object>(i));
+    }
+    if (!values.empty())
+        invocation->result(values);
+    else if (!notFound.empty())
+        invocation->result(std::make_tuple(notFound));
+    else
+        invocation->error(ERROR_URI, std::make_tuple(error.empty() ? std::string("No partition answered") : error));
+}
+
+} /* namespace wampinterfaceforomnetpp */
@@ -0,0 +1,119 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef PARTITIONROUTER_H_
+#define PARTITIONROUTER_H_
+
+#include <omnetpp.h>
+#include <string>
+#include <vector>
+#include <autobahn/autobahn.hpp>
+
+#include "ModuleIndex.h"
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Routes setParameter and getParameter calls between the partitions of a parallel simulation.
+ *
+ * Under parallel simulation every partition runs in its own process and only instantiates
+ * its own modules, the others are placeholders. Each partition has a SimulationCallee that
+ * registers its procedures as a shard, under shardUri(). The callee of partition 0 also
+ * registers the procedures under their plain names and routes set and get calls to the
+ * partition that owns the module: the path of a simple module is looked up in the local module
+ * tree and then in the partition-id option. Selectors with wildcards, compound modules, which
+ * exist in every partition that has one of their submodules, and modules whose partition is
+ * unknown go to all partitions and their results are merged.
+ *
+ * Without parallel simulation there is a single partition and nothing is routed.
+ */
+class PartitionRouter {
+public:
+    /**
+     * How the results of the partitions are combined.
+     */
+    enum Merge {
+        /**
+         * setParameter: success if any partition set the parameter, otherwise the first failure.
+         */
+        SET,
+        /**
+         * getParameter: the values of all partitions in the order of the partitions.
+         */
+        GET
+    };
+
+    PartitionRouter();
+
+    /**
+     * Reads the partition of this process. Called on the simulation thread when the callee starts.
+     */
+    void start(WAMPConnection *connection);
+
+    bool isPartitioned() const {
+        return numPartitions > 1;
+    }
+
+    int getPartitionId() const {
+        return partitionId;
+    }
+
+    /**
+     * Returns the URI under which the given partition registers the procedure.
+     */
+    static std::string shardUri(const std::string& procedure, int partition);
+
+    /**
+     * Returns the partitions that may own modules addressed by the selector, only this one if it
+     * addresses a local simple module. Called on the simulation thread.
+     */
+    std::vector<int> findPartitions(const std::string& selector, const ModuleIndex& index) const;
+
+    /**
+     * Calls the shards of the procedure in the given partitions on the I/O thread and answers the
+     * invocation with their merged results, or with an error if the session is not joined.
+     */
+    void forward(autobahn::wamp_invocation invocation, const std::string& procedure,
+            const std::vector<int>& partitions, const std::vector<std::string>& arguments, Merge merge);
+
+private:
+    /**
+     * Result of the call of one shard.
+     */
+    struct Outcome {
+        bool failed;
+        std::string error;
+        autobahn::wamp_call_result result;
+    };
+
+    /**
+     * Answers the invocation with the merged outcomes. Runs on the I/O thread.
+     */
+    static void reply(autobahn::wamp_invocation invocation, Merge merge, std::vector<Outcome>& outcomes);
+
+    int partitionId;
+    int numPartitions;
+    WAMPConnection *connection;
+
+    /**
+     * Continuations of forwarded calls, kept until they ran. Only used on the I/O thread.
+     */
+    std::vector<boost::future<void>> pending;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* PARTITIONROUTER_H_ */
@@ -0,0 +1,112 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ProgressHeartbeat.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+#include "ConnectionManager.h"
+
+namespace wampinterfaceforomnetpp {
+
+ProgressHeartbeat::ProgressHeartbeat() :
+        started(false), publisher(nullptr), interval(0), lastEventNumber(0) {
+}
+
+ProgressHeartbeat::~ProgressHeartbeat() {
+    stop();
+}
+
+void ProgressHeartbeat::start(const std::string& uri, double seconds) {
+    stop();
+    if (seconds < 0)
+        throw omnetpp::cRuntimeError("Heartbeat interval must not be negative, got %g", seconds);
+    if (seconds == 0)
+        return;
+
+    started = true;
+    publisher = ConnectionManager::getInstance().acquirePublisher(uri);
+    if (publisher == nullptr)
+        return;
+    topic.reset(new LiveTopic(uri.c_str()));
+    // the heartbeat is only collected while somebody listens, also without wamp-demand-driven
+    topic->alwaysTracked = true;
+    publisher->getDemand().attach(topic.get());
+
+    interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds));
+    lastWallTime = std::chrono::steady_clock::now();
+    due = lastWallTime + interval;
+    lastSimTime = omnetpp::simTime();
+    lastEventNumber = omnetpp::getSimulation()->getEventNumber();
+}
+
+void ProgressHeartbeat::stop() {
+    if (publisher != nullptr)
+        publisher->getDemand().detach(topic.get());
+    publisher = nullptr;
+    if (started)
+        ConnectionManager::getInstance().release();
+    started = false;
+}
+
+void ProgressHeartbeat::tick() {
+    if (publisher == nullptr)
+        return;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now < due)
+        return;
+    // a late tick does not cause a burst of heartbeats
+    due = now + interval;
+
+    omnetpp::cSimulation *simulation = omnetpp::getSimulation();
+    omnetpp::simtime_t simTime = simulation->getSimTime();
+    int64_t eventNumber = simulation->getEventNumber();
+    double elapsed = std::chrono::duration<double>(now - lastWallTime).count();
+    double eventRate = elapsed > 0 ? (eventNumber - lastEventNumber) / elapsed : 0;
+    double simTimeRate = elapsed > 0 ? (simTime - lastSimTime).dbl() / elapsed : 0;
+    lastWallTime = now;
+    lastSimTime = simTime;
+    lastEventNumber = eventNumber;
+
+    if (!topic->observed.load(std::memory_order_relaxed))
+        return;
+
+    double wallClockTime = std::chrono::duration<double>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    Progress progress(simTime.raw(), omnetpp::SimTime::getScaleExp(), eventNumber, eventRate, simTimeRate,
+            wallClockTime, simulation->getFES()->getLength(), getResidentMemory());
+    WAMPConnection *target = &publisher->getConnection();
+    std::string uri = topic->uri;
+    target->post([target, uri, progress]() {
+        target->publish(uri, progress);
+    });
+}
+
+uint64_t ProgressHeartbeat::getResidentMemory() {
+    // the second field of statm is the resident set in pages
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int fields = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+    if (fields != 2)
+        return 0;
+    return (uint64_t) resident * sysconf(_SC_PAGESIZE);
+}
+
+} /* namespace wampinterfaceforomnetpp */
@@ -0,0 +1,94 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef PROGRESSHEARTBEAT_H_
+#define PROGRESSHEARTBEAT_H_
+
+#include <omnetpp.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "LivePublisher.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Publishes the progress of the run in regular wall-clock intervals, so monitors can tell a
+ * stalled run from a slow one without polling.
+ *
+ * Each event carries (rawTime, scaleExponent, eventNumber, eventsPerSecond, simSecondsPerSecond,
+ * wallClockTime, futureEvents, residentBytes). The rates are measured since the previous heartbeat,
+ * the wall-clock time is in seconds since the epoch. The LiveDemand of its connection tracks the
+ * subscribers of the topic even without wamp-demand-driven, so no progress is collected while nobody
+ * subscribed to it. Only a router without the subscription meta API gets the heartbeat regardless.
+ *
+ * Only used on the simulation thread, the events are published by the I/O thread. The heartbeat
+ * only comes when the simulation thread calls tick(), a missing heartbeat means that the run hangs.
+ */
+class ProgressHeartbeat {
+public:
+    typedef std::tuple<int64_t, int, int64_t, double, double, double, int, uint64_t> Progress;
+
+    ProgressHeartbeat();
+
+    /**
+     * Stops the heartbeat.
+     */
+    ~ProgressHeartbeat();
+
+    /**
+     * Starts publishing on the topic every interval seconds. Nothing is published if the
+     * interval is 0 or live-sink does not include the router.
+     */
+    void start(const std::string& topic, double interval);
+
+    void stop();
+
+    /**
+     * Publishes the progress if the interval has passed. Called as often as convenient,
+     * e.g. by a ticker of the WAMPScheduler.
+     */
+    void tick();
+
+private:
+    /**
+     * Returns the resident set size of the process in bytes, 0 where it cannot be read.
+     */
+    static uint64_t getResidentMemory();
+
+    /**
+     * Whether the heartbeat holds a user of the ConnectionManager.
+     */
+    bool started;
+
+    LivePublisher *publisher;
+    std::unique_ptr<LiveTopic> topic;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point due;
+
+    /**
+     * Progress at the previous heartbeat, for the rates.
+     */
+    std::chrono::steady_clock::time_point lastWallTime;
+    omnetpp::simtime_t lastSimTime;
+    int64_t lastEventNumber;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* PROGRESSHEARTBEAT_H_ */
@@ -0,0 +1,59 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef REQUESTQUEUE_H_
+#define REQUESTQUEUE_H_
+
+#include <mutex>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Queue that hands requests from the I/O threads to the simulation thread in batches.
+ *
+ * Any thread may push. The simulation thread takes all queued requests at once,
+ * so a burst of requests costs a single lock on its side. The batch vectors are
+ * swapped, not copied, so their capacity is reused.
+ */
+template<typename T>
+class RequestQueue {
+public:
+    void push(const T& request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(request);
+    }
+
+    /**
+     * Moves all queued requests into the empty batch.
+     */
+    void take(std::vector<T>& batch) {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(queued);
+    }
+
+    bool isEmpty() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queued.empty();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<T> queued;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* REQUESTQUEUE_H_ */
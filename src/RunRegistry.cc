@@ -0,0 +1,174 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "RunRegistry.h"
+
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <unistd.h>
+
+namespace wampinterfaceforomnetpp {
+
+Register_GlobalConfigOption(CFGID_WAMP_RUN_NAMESPACE, "wamp-run-namespace", CFG_BOOL, "false",
+        "Whether the procedure and topic URIs of a run are prefixed with "
+        "<wamp-run-namespace-root>.<config>.<run number>.<process id>, so parallel runs can share one router. "
+        "The runs then announce themselves and can be listed with wampinterfaceforomnetpp.runs.list.");
+Register_GlobalConfigOption(CFGID_WAMP_RUN_NAMESPACE_ROOT, "wamp-run-namespace-root", CFG_STRING, "run",
+        "First component of the URI prefix of wamp-run-namespace.");
+
+const char *RunRegistry::ANNOUNCE_TOPIC = "wampinterfaceforomnetpp.runs.announced";
+const char *RunRegistry::WITHDRAW_TOPIC = "wampinterfaceforomnetpp.runs.withdrawn";
+const char *RunRegistry::LIST_PROCEDURE = "wampinterfaceforomnetpp.runs.list";
+
+namespace {
+
+/**
+ * Invocation policy of the list procedure, all runs must register it with the same one.
+ */
+const char *LIST_INVOKE_POLICY = "roundrobin";
+
+/**
+ * Replaces the characters that cannot appear in a URI component.
+ */
+std::string toUriComponent(const std::string& text) {
+    std::string component = text.empty() ? "_" : text;
+    for (char& c : component) {
+        if (c == '.' || c == '#' || isspace((unsigned char) c))
+            c = '_';
+    }
+    return component;
+}
+
+}
+
+RunRegistry& RunRegistry::getInstance() {
+    static RunRegistry instance;
+    return instance;
+}
+
+RunRegistry::RunRegistry() :
+        connection(nullptr), setupId(-1) {
+}
+
+std::string RunRegistry::getNamespace() {
+    omnetpp::cConfiguration *config = omnetpp::getEnvir()->getConfig();
+    if (!config->getAsBool(CFGID_WAMP_RUN_NAMESPACE))
+        return "";
+    std::string prefix = config->getAsString(CFGID_WAMP_RUN_NAMESPACE_ROOT) + "."
+            + toUriComponent(config->getActiveConfigName()) + "." + std::to_string(config->getActiveRunNumber());
+    // the partitions of a parallel simulation are processes of the same run and share its namespace
+    if (omnetpp::getEnvir()->getParsimNumPartitions() > 1)
+        return prefix;
+    return prefix + "." + std::to_string(getpid());
+}
+
+std::string RunRegistry::qualify(const std::string& uri) {
+    std::string prefix = getNamespace();
+    return prefix.empty() ? uri : prefix + "." + uri;
+}
+
+void RunRegistry::start(WAMPConnection& connection) {
+    std::string prefix = getNamespace();
+    // a parallel simulation is announced once, by partition 0
+    if (prefix.empty() || omnetpp::getEnvir()->getParsimProcId() > 0)
+        return;
+
+    omnetpp::cConfiguration *config = omnetpp::getEnvir()->getConfig();
+    const char *iterationVars = config->getVariable("iterationvars");
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    double startTime = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    self = RunInfo(prefix, config->getActiveConfigName(), config->getActiveRunNumber(), getpid(), host,
+            iterationVars != nullptr ? iterationVars : "", startTime);
+    this->connection = &connection;
+
+    // subscriptions and registrations are gone after a reconnect, so the run announces itself again
+    setupId = connection.addSetup([this](WAMPConnection& connection) {
+        try {
+            connection.request([this](std::shared_ptr<autobahn::wamp_session> session) {
+                return session->subscribe(ANNOUNCE_TOPIC, [this](const autobahn::wamp_event& event) {
+                    announced(event.argument<RunInfo>(0));
+                });
+            }).get();
+            connection.request([this](std::shared_ptr<autobahn::wamp_session> session) {
+                return session->subscribe(WITHDRAW_TOPIC, [this](const autobahn::wamp_event& event) {
+                    runs.erase(event.argument<std::string>(0));
+                });
+            }).get();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+
+        try {
+            connection.request([this](std::shared_ptr<autobahn::wamp_session> session) {
+                autobahn::provide_options options;
+                options["invoke"] = msgpack::object(LIST_INVOKE_POLICY);
+                return session->provide(LIST_PROCEDURE, [this](autobahn::wamp_invocation invocation) {
+                    list(invocation);
+                }, options);
+            }).get();
+        } catch (const std::exception& e) {
+            // e.g. a router without shared registrations, then only the first run answers
+            std::cerr << "cannot register " << LIST_PROCEDURE << ": " << e.what() << std::endl;
+        }
+
+        WAMPConnection *target = this->connection;
+        if (target != nullptr)
+            target->post([this]() {announce();});
+        return true;
+    });
+}
+
+void RunRegistry::stop() {
+    WAMPConnection *target = connection.exchange(nullptr);
+    if (target == nullptr)
+        return;
+
+    target->removeSetup(setupId);
+    std::string prefix = std::get<0>(self);
+    target->post([this, target, prefix]() {
+        target->publish(WITHDRAW_TOPIC, std::make_tuple(prefix));
+        runs.clear();
+    });
+}
+
+void RunRegistry::announce() {
+    WAMPConnection *target = connection;
+    if (target != nullptr)
+        target->publish(ANNOUNCE_TOPIC, std::make_tuple(self));
+}
+
+void RunRegistry::announced(const RunInfo& run) {
+    const std::string& prefix = std::get<0>(run);
+    if (prefix == std::get<0>(self))
+        return;
+    bool known = runs.count(prefix) > 0;
+    runs[prefix] = run;
+    // a new run does not know the runs that announced themselves before it
+    if (!known)
+        announce();
+}
+
+void RunRegistry::list(autobahn::wamp_invocation invocation) {
+    std::vector<RunInfo> result;
+    result.push_back(self);
+    for (auto& run : runs)
+        result.push_back(run.second);
+    invocation->result(std::make_tuple(result));
+}
+
+} /* namespace wampinterfaceforomnetpp */
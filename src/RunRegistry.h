@@ -0,0 +1,120 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef RUNREGISTRY_H_
+#define RUNREGISTRY_H_
+
+#include <omnetpp.h>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <autobahn/autobahn.hpp>
+
+#include "WAMPConnection.h"
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Namespace of the procedure and topic URIs of a run, and the registry of the runs on a router.
+ *
+ * With the ini option wamp-run-namespace, all URIs of a run are prefixed with
+ * <wamp-run-namespace-root>.<config>.<run number>.<process id>, so the runs of a parameter
+ * sweep can share one router. Each run then announces itself on the topic ANNOUNCE_TOPIC and
+ * withdraws on WITHDRAW_TOPIC when it ends. The runs keep track of each other from these
+ * events and answer LIST_PROCEDURE, which they register as a shared registration, so any
+ * of them can list all active runs. A run that crashed cannot withdraw and is listed until
+ * the remaining runs are restarted.
+ */
+class RunRegistry {
+public:
+    /**
+     * Description of a run: namespace, config name, run number, process id, host,
+     * iteration variables and wall-clock start time in seconds since the epoch.
+     */
+    typedef std::tuple<std::string, std::string, int, int64_t, std::string, std::string, double> RunInfo;
+
+    static const char *ANNOUNCE_TOPIC;
+    static const char *WITHDRAW_TOPIC;
+    static const char *LIST_PROCEDURE;
+
+    static RunRegistry& getInstance();
+
+    /**
+     * Returns the namespace of the active run, empty if wamp-run-namespace is not set.
+     * The partitions of a parallel simulation share the namespace, it has no process id then.
+     */
+    static std::string getNamespace();
+
+    /**
+     * Returns the URI within the namespace of the active run.
+     */
+    static std::string qualify(const std::string& uri);
+
+    /**
+     * Announces the active run on the connection and answers the list procedure until stop().
+     * Does nothing if wamp-run-namespace is not set, or in the partitions of a parallel simulation but the first.
+     */
+    void start(WAMPConnection& connection);
+
+    /**
+     * Withdraws the run. Called before the connection is stopped, so the withdrawal still goes out.
+     */
+    void stop();
+
+private:
+    RunRegistry();
+    RunRegistry(const RunRegistry&) = delete;
+    RunRegistry& operator=(const RunRegistry&) = delete;
+
+    /**
+     * Publishes the description of this run. Runs on the I/O thread.
+     */
+    void announce();
+
+    /**
+     * Handles the announcement of another run. Runs on the I/O thread.
+     */
+    void announced(const RunInfo& run);
+
+    /**
+     * Answers the list procedure with this run and the known other runs. Runs on the I/O thread.
+     */
+    void list(autobahn::wamp_invocation invocation);
+
+    /**
+     * Connection the run is announced on, nullptr while stopped.
+     * Read by the event handlers on the I/O thread.
+     */
+    std::atomic<WAMPConnection*> connection;
+
+    /**
+     * Id of the setup on connection.
+     */
+    int setupId;
+
+    RunInfo self;
+
+    /**
+     * Other runs by namespace, only used on the I/O thread.
+     */
+    std::map<std::string, RunInfo> runs;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* RUNREGISTRY_H_ */
@@ -19,198 +19,505 @@ namespace wampinterfaceforomnetpp {
 
 Define_Module(SimulationCallee);
 
+/**
+ * Error of invocations whose request failed, e.g. because of a malformed module selector.
+ */
+static const char *ERROR_URI = "wampinterfaceforomnetpp.error.request_failed";
+
+/**
+ * Modules per chunk of getSnapshot if the caller does not give a size.
+ */
+static const long SNAPSHOT_CHUNK_SIZE = 500;
+
 // Initialize class variables
 std::string SimulationCallee::calleeModulePath = "Tictoc.callee";
 
-boost::lockfree::queue<ParameterMsg*> SimulationCallee::ParametersToSet{100};
+RequestQueue<SimulationCallee::QueuedRequest> SimulationCallee::requests;
+
+std::atomic<bool> SimulationCallee::accepting(false);
+
+PartitionRouter SimulationCallee::partitionRouter;
+
+SimulationCallee::SimulationCallee() :
+        wampConnection(nullptr), setupId(-1), schedulerHandlerId(-1), schedulerTickerId(-1) {
+}
+
+SimulationCallee::~SimulationCallee() {
+    detachScheduler();
+    releaseConnection();
+}
+
+void SimulationCallee::detachScheduler() {
+    WAMPScheduler *scheduler = WAMPScheduler::getActive();
+    if (schedulerHandlerId >= 0 && scheduler != nullptr)
+        scheduler->removeHandler(schedulerHandlerId);
+    if (schedulerTickerId >= 0 && scheduler != nullptr)
+        scheduler->removeTicker(schedulerTickerId);
+    schedulerHandlerId = -1;
+    schedulerTickerId = -1;
+}
+
+void SimulationCallee::releaseConnection() {
+    if (wampConnection != nullptr) {
+        accepting = false;
+        rejectPendingRequests("The simulation has finished");
+        wampConnection->removeSetup(setupId);
+        wampConnection = nullptr;
+        ConnectionManager::getInstance().release();
+    }
+}
+
+void SimulationCallee::enqueue(const char *procedure, autobahn::wamp_invocation invocation,
+        const Request& request) {
+    std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now();
+    QueuedRequest queued;
+    queued.invocation = invocation;
+    queued.request = [procedure, arrival, invocation, request](SimulationCallee& callee, std::vector<Reply>& replies) {
+        try {
+            request(callee, replies);
+        } catch (const omnetpp::cTerminationException& e) {
+            // e.g. stopSimulation was set
+            throw;
+        } catch (const std::exception& e) {
+            // a malformed request must not end the simulation
+            replies.push_back(makeError(invocation, e.what()));
+        }
+        if (BridgeMetrics::getInstance().isEnabled())
+            replies.push_back(measureService(procedure, arrival));
+    };
+    queued.write = false;
+    submit(queued);
+}
+
+void SimulationCallee::submit(const QueuedRequest& queued) {
+    // the procedures stay registered until the connection stops, e.g. while recorders still use it
+    if (!accepting) {
+        queued.invocation->error(ERROR_URI, std::make_tuple(std::string("The simulation is not running")));
+        return;
+    }
+    requests.push(queued);
+    WAMPScheduler::notify();
+}
+
+SimulationCallee::Reply SimulationCallee::measureService(const char *procedure,
+        std::chrono::steady_clock::time_point arrival) {
+    return [procedure, arrival]() {
+        BridgeMetrics::getInstance().getProcedure(procedure).recordSince(arrival);
+    };
+}
+
+template<typename T>
+SimulationCallee::Reply SimulationCallee::makeReply(autobahn::wamp_invocation invocation, const T& result) {
+    return [invocation, result]() {
+        invocation->result(result);
+    };
+}
+
+SimulationCallee::Reply SimulationCallee::makeError(autobahn::wamp_invocation invocation, const std::string& message) {
+    return [invocation, message]() {
+        invocation->error(ERROR_URI, std::make_tuple(message));
+    };
+}
 
 void SimulationCallee::getSubmodules(autobahn::wamp_invocation invocation) {
     std::string modulePath = invocation->argument<std::string>(0);
-    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
-    std::list<std::tuple<std::string, std::string>>* modules = new std::list<
-            std::tuple<std::string, std::string>>();
-
-    cModule* module;
-    if (modulePath == "") {
-        module = sim->getSystemModule();
-        std::tuple<std::string, std::string> myTuple = std::make_tuple(
-                module->getFullName(), module->getModuleType()->str());
-        modules->push_back(myTuple);
-        invocation->result(*modules);
-    } else {
-        module = sim->getModuleByPath(modulePath.c_str());
-        if (module != nullptr) {
-            for (cModule::SubmoduleIterator it(module); !it.end(); ++it) {
-                modules->push_back(
-                        std::make_tuple((*it)->getFullName(),
-                                (*it)->getModuleType()->str()));
-            }
-            invocation->result(*modules);
+
+    enqueue("getSubmodules", invocation, [invocation, modulePath](SimulationCallee& callee, std::vector<Reply>& replies) {
+        std::list<std::tuple<std::string, std::string>> modules;
+
+        cModule* module;
+        if (modulePath == "") {
+            module = getSimulation()->getSystemModule();
+            std::tuple<std::string, std::string> myTuple = std::make_tuple(
+                    module->getFullName(), module->getModuleType()->str());
+            modules.push_back(myTuple);
+            replies.push_back(makeReply(invocation, modules));
         } else {
-            invocation->result("Module not found");
+            module = callee.moduleIndex.find(modulePath);
+            if (module != nullptr) {
+                for (cModule::SubmoduleIterator it(module); !it.end(); ++it) {
+                    modules.push_back(
+                            std::make_tuple((*it)->getFullName(),
+                                    (*it)->getModuleType()->str()));
+                }
+                replies.push_back(makeReply(invocation, modules));
+            } else {
+                replies.push_back(makeReply(invocation, std::string("Module not found")));
+            }
         }
-    }
-    delete modules;
+    });
 }
 
 void SimulationCallee::getModuleParameterNames(
         autobahn::wamp_invocation invocation) {
     std::string modulePath = invocation->argument<std::string>(0);
-    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
-    std::list<std::tuple<std::string, std::string, std::string>>* parameters = new std::list<
-            std::tuple<std::string, std::string, std::string>>();
 
-    cModule* module;
-    if (modulePath == "") {
-        module = sim->getSystemModule();
-    } else {
-        module = sim->getModuleByPath(modulePath.c_str());
-    }
+    enqueue("getModuleParameterNames", invocation, [invocation, modulePath](SimulationCallee& callee, std::vector<Reply>& replies) {
+        std::list<std::tuple<std::string, std::string, std::string>> parameters;
+
+        cModule* module;
+        if (modulePath == "") {
+            module = getSimulation()->getSystemModule();
+        } else {
+            module = callee.moduleIndex.find(modulePath);
+        }
+
+        if (module != nullptr) {
+            for (int i = 0; i < module->getNumParams(); ++i) {
+                std::string name = module->par(i).getFullName();
+                std::string type;
+                type = module->par(i).getTypeName(module->par(i).getType());
+                if (module->par(i).isVolatile()) {
+                    type = "volatile " + type;
+                }
+                std::string unit("");
+                const char * unit_or_null = module->par(i).getUnit();
+                if (unit_or_null) {
+                    unit = unit_or_null;
+                }
+                parameters.push_back(std::make_tuple(name, type, unit));
 
-    if (module != nullptr) {
-        for (int i = 0; i < module->getNumParams(); ++i) {
-            std::string name = module->par(i).getFullName();
-            std::string type;
-            type = module->par(i).getTypeName(module->par(i).getType());
-            if (module->par(i).isVolatile()) {
-                type = "volatile " + type;
             }
-            std::string unit("");
-            const char * unit_or_null = module->par(i).getUnit();
-            if (unit_or_null) {
-                unit = unit_or_null;
+            replies.push_back(makeReply(invocation, parameters));
+        } else
+            replies.push_back(makeReply(invocation, std::make_tuple("Module not found")));
+    });
+}
+
+void SimulationCallee::getSnapshot(autobahn::wamp_invocation invocation) {
+    size_t arguments = invocation->number_of_arguments();
+    std::string modulePath = arguments > 0 ? invocation->argument<std::string>(0) : "";
+    long depth = arguments > 1 ? invocation->argument<long>(1) : -1;
+    long chunkSize = arguments > 2 ? invocation->argument<long>(2) : SNAPSHOT_CHUNK_SIZE;
+    bool progressive = invocation->progressive_results_expected();
+    if (chunkSize < 1)
+        chunkSize = SNAPSHOT_CHUNK_SIZE;
+
+    enqueue("getSnapshot", invocation, [invocation, modulePath, depth, chunkSize, progressive](SimulationCallee& callee,
+            std::vector<Reply>& replies) {
+        cModule *root = modulePath == "" ? getSimulation()->getSystemModule() : callee.moduleIndex.find(modulePath);
+        if (root == nullptr) {
+            replies.push_back(makeReply(invocation, std::make_tuple("Module not found")));
+            return;
+        }
+
+        std::vector<ModuleInfo> chunk;
+        std::vector<std::pair<cModule*, long>> stack;
+        std::vector<cModule*> submodules;
+        stack.push_back(std::make_pair(root, 0L));
+        while (!stack.empty()) {
+            cModule *module = stack.back().first;
+            long level = stack.back().second;
+            stack.pop_back();
+            chunk.push_back(describeModule(module));
+
+            if (depth < 0 || level < depth) {
+                submodules.clear();
+                for (cModule::SubmoduleIterator it(module); !it.end(); ++it)
+                    submodules.push_back(*it);
+                // reversed, so the modules are listed in tree order
+                for (auto it = submodules.rbegin(); it != submodules.rend(); ++it)
+                    stack.push_back(std::make_pair(*it, level + 1));
             }
-            parameters->push_back(std::make_tuple(name, type, unit));
 
+            if (progressive && (long) chunk.size() >= chunkSize && !stack.empty()) {
+                // handed to the I/O thread while walking on, so the first chunks may go out early; without
+                // flow control the queued chunks can still hold the whole tree while the I/O thread lags behind
+                callee.sendReply([invocation, chunk]() {
+                    invocation->progress(std::make_tuple(chunk));
+                });
+                chunk.clear();
+            }
         }
-        invocation->result(*parameters);
-    } else
-        invocation->result(std::make_tuple("Module not found"));
-    delete parameters;
+        replies.push_back(makeReply(invocation, std::make_tuple(chunk)));
+    });
 }
 
-void SimulationCallee::setParameter(autobahn::wamp_invocation invocation) {
-    std::string module = invocation->argument<std::string>(0);
+void SimulationCallee::watchParameter(autobahn::wamp_invocation invocation) {
+    std::string selector = invocation->argument<std::string>(0);
     std::string paramName = invocation->argument<std::string>(1);
-    std::string value = invocation->argument<std::string>(2);
 
-    ParameterMsg* msg = new ParameterMsg();
-    msg->moduleName = module;
-    msg->paramName = paramName;
-    msg->value = value;
-
-    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
-    cSimpleModule *mod = (cSimpleModule*) (sim->getModuleByPath(
-            module.c_str()));
-    if (mod != nullptr) {
-        ParametersToSet.push(msg);
-        invocation->result(std::make_tuple("\n"));
-    } else
-        invocation->result(std::make_tuple("Module not found"));
+    enqueue("watchParameter", invocation, [invocation, selector, paramName](SimulationCallee& callee, std::vector<Reply>& replies) {
+        long id = callee.parameterWatcher.watch(selector, paramName);
+        replies.push_back(makeReply(invocation, std::make_tuple(id, callee.parameterChangedTopic)));
+    });
 }
 
-void SimulationCallee::getParameter(autobahn::wamp_invocation invocation) {
+void SimulationCallee::unwatchParameter(autobahn::wamp_invocation invocation) {
+    long id = invocation->argument<long>(0);
+
+    enqueue("unwatchParameter", invocation, [invocation, id](SimulationCallee& callee, std::vector<Reply>& replies) {
+        replies.push_back(makeReply(invocation, std::make_tuple(callee.parameterWatcher.unwatch(id))));
+    });
+}
+
+void SimulationCallee::controlRun(const char *procedure, autobahn::wamp_invocation invocation,
+        const std::function<void(WAMPScheduler&)>& change) {
+    enqueue(procedure, invocation, [invocation, change](SimulationCallee& callee, std::vector<Reply>& replies) {
+        WAMPScheduler *scheduler = WAMPScheduler::getActive();
+        if (scheduler == nullptr)
+            throw cRuntimeError("Run control needs scheduler-class = \"wampinterfaceforomnetpp::WAMPScheduler\"");
+        change(*scheduler);
+        RunState state(WAMPScheduler::getRunModeName(scheduler->getRunMode()), simTime().str(),
+                getSimulation()->getEventNumber(), scheduler->isRealTime(), scheduler->getRealTimeFactor());
+        replies.push_back(makeReply(invocation, state));
+    });
+}
+
+void SimulationCallee::pause(autobahn::wamp_invocation invocation) {
+    controlRun("pause", invocation, [](WAMPScheduler& scheduler) {scheduler.pause();});
+}
+
+void SimulationCallee::resume(autobahn::wamp_invocation invocation) {
+    controlRun("resume", invocation, [](WAMPScheduler& scheduler) {scheduler.resume();});
+}
+
+void SimulationCallee::step(autobahn::wamp_invocation invocation) {
+    long events = invocation->number_of_arguments() > 0 ? invocation->argument<long>(0) : 1;
+    controlRun("step", invocation, [events](WAMPScheduler& scheduler) {scheduler.step(events);});
+}
+
+void SimulationCallee::runUntil(autobahn::wamp_invocation invocation) {
+    std::string time = invocation->argument<std::string>(0);
+    controlRun("runUntil", invocation, [time](WAMPScheduler& scheduler) {scheduler.runUntil(SimTime::parse(time.c_str()));});
+}
+
+void SimulationCallee::setRealTime(autobahn::wamp_invocation invocation) {
+    bool enabled = invocation->argument<bool>(0);
+    double factor = invocation->number_of_arguments() > 1 ? invocation->argument<double>(1) : 1;
+    controlRun("setRealTime", invocation, [enabled, factor](WAMPScheduler& scheduler) {scheduler.setRealTime(enabled, factor);});
+}
+
+void SimulationCallee::getRunState(autobahn::wamp_invocation invocation) {
+    controlRun("getRunState", invocation, [](WAMPScheduler& scheduler) {});
+}
+
+void SimulationCallee::getMetrics(autobahn::wamp_invocation invocation) {
+    std::vector<std::map<std::string, uint64_t>> connections;
+    for (auto& counters : ConnectionManager::getInstance().getCounters())
+        connections.push_back(counters.toMap());
+    invocation->result(std::make_tuple(connections, BridgeMetrics::getInstance().summarize()));
+}
+
+void SimulationCallee::routeSetParameter(autobahn::wamp_invocation invocation) {
+    route("route.setParameter", PartitionRouter::SET, &SimulationCallee::setParameterPath, &setParameter, invocation);
+}
+
+void SimulationCallee::routeGetParameter(autobahn::wamp_invocation invocation) {
+    route("route.getParameter", PartitionRouter::GET, &SimulationCallee::getParameterPath, &getParameter, invocation);
+}
+
+void SimulationCallee::route(const char *procedure, PartitionRouter::Merge merge, std::string SimulationCallee::*path,
+        autobahn::wamp_procedure local, autobahn::wamp_invocation invocation) {
+    std::vector<std::string> arguments;
+    for (size_t i = 0; i < invocation->number_of_arguments(); ++i)
+        arguments.push_back(invocation->argument<std::string>(i));
+    if (arguments.empty())
+        throw std::invalid_argument("Missing module path");
+
+    // the module tree is only read on the simulation thread
+    enqueue(procedure, invocation, [invocation, merge, path, local, arguments](SimulationCallee& callee,
+            std::vector<Reply>& replies) {
+        std::vector<int> partitions = partitionRouter.findPartitions(arguments[0], callee.moduleIndex);
+        if (partitions.size() == 1 && partitions[0] == partitionRouter.getPartitionId()) {
+            replies.push_back([local, invocation]() {local(invocation);});
+            return;
+        }
+        std::string uri = callee.*path;
+        replies.push_back([invocation, uri, partitions, arguments, merge]() {
+            partitionRouter.forward(invocation, uri, partitions, arguments, merge);
+        });
+    });
+}
+
+SimulationCallee::ModuleInfo SimulationCallee::describeModule(cModule *module) {
+    std::vector<ParameterInfo> parameters;
+    parameters.reserve(module->getNumParams());
+    for (int i = 0; i < module->getNumParams(); ++i) {
+        cPar& parameter = module->par(i);
+        std::string type = parameter.getTypeName(parameter.getType());
+        if (parameter.isVolatile())
+            type = "volatile " + type;
+        const char *unit = parameter.getUnit();
+        parameters.push_back(std::make_tuple(std::string(parameter.getFullName()), type,
+                std::string(unit != nullptr ? unit : ""), parameter.str()));
+    }
+    return std::make_tuple(module->getFullPath(), module->getModuleType()->str(), parameters);
+}
+
+void SimulationCallee::setParameter(autobahn::wamp_invocation invocation) {
     std::string module = invocation->argument<std::string>(0);
     std::string paramName = invocation->argument<std::string>(1);
+    std::string value = invocation->argument<std::string>(2);
+    std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now();
+
+    QueuedRequest queued;
+    queued.invocation = invocation;
+    queued.request = [invocation, module, paramName, value, arrival](SimulationCallee& callee, std::vector<Reply>&) {
+        callee.parametersToSet.push(module, paramName, value, invocation, arrival);
+    };
+    queued.write = true;
+    submit(queued);
+}
 
-    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
-    cSimpleModule *mod = (cSimpleModule*) (sim->getModuleByPath(module.c_str()));
-    if (mod != nullptr) {
-        if (mod->hasPar(paramName.c_str())) {
-            if (mod->par(paramName.c_str()).isExpression()) {
-                std::string res =
-                        mod->par(paramName.c_str()).getExpression()->str();
-                res = "=" + res;
-                invocation->result(std::make_tuple(res));
-            } else {
-                omnetpp::cPar::Type type =
-                        mod->par(paramName.c_str()).getType();
-                if (type == 'D') {
-                    std::list<double> results_d;
-                    traverseGetPath(module, nullptr, paramName, &results_d);
-                    invocation->result(results_d);
-                } else if (type == 'S') {
-                    std::list<const char*> results_s;
-                    traverseGetPath(module, nullptr, paramName, &results_s);
-                    invocation->result(results_s);
-                } else if (type == 'L') {
-                    std::list<long> results_l;
-                    traverseGetPath(module, nullptr, paramName, &results_l);
-                    invocation->result(results_l);
-                } else if (type == 'B') {
-                    std::list<bool> results_b;
-                    traverseGetPath(module, nullptr, paramName, &results_b);
-                    invocation->result(results_b);
+void SimulationCallee::applyQueuedParameters(std::vector<Reply>& replies) {
+    if (parametersToSet.isEmpty())
+        return;
+    parametersToSet.take(parameterBatch);
+    BridgeMetrics& metrics = BridgeMetrics::getInstance();
+    bool measuring = metrics.isEnabled();
+    std::vector<std::chrono::steady_clock::time_point> arrivals;
+    std::vector<cModule*> modules;
+    for (size_t i = 0; i < parameterBatch.size(); ++i) {
+        ParameterQueue::Entry *entry = parameterBatch[i];
+        const ParameterMsg& msg = entry->msg;
+        std::string result;
+        try {
+            modules.clear();
+            moduleIndex.resolve(msg.moduleName, modules);
+            if (!modules.empty()) {
+                for (cModule *module : modules)
+                    setSingleParameter(module, msg.paramName, msg.value);
+                result = "\n";
+                if (measuring) {
+                    for (auto& arrival : entry->arrivals)
+                        metrics.getParameterApply().recordSince(arrival);
                 }
+            } else {
+                result = "Module not found";
             }
-        } else {
-            invocation->result(std::make_tuple("Parameter not found"));
+        } catch (const omnetpp::cTerminationException& e) {
+            // the write that ended the run was applied, the ones after it are not
+            for (auto& invocation : entry->invocations)
+                replies.push_back(makeReply(invocation, std::make_tuple(std::string("\n"))));
+            for (size_t j = i + 1; j < parameterBatch.size(); ++j) {
+                for (auto& invocation : parameterBatch[j]->invocations)
+                    replies.push_back(makeError(invocation, "The simulation ended before the parameter was set"));
+            }
+            parametersToSet.recycle(parameterBatch);
+            throw;
+        } catch (const std::exception& e) {
+            for (auto& invocation : entry->invocations)
+                replies.push_back(makeError(invocation, e.what()));
+            continue;
         }
-    } else {
-        invocation->result(std::make_tuple("Module not found"));
+        // writes that were overwritten by a later one are answered like the one that was applied
+        for (auto& invocation : entry->invocations)
+            replies.push_back(makeReply(invocation, std::make_tuple(result)));
+    }
+    if (measuring) {
+        for (ParameterQueue::Entry *entry : parameterBatch)
+            arrivals.insert(arrivals.end(), entry->arrivals.begin(), entry->arrivals.end());
+        // after the replies of the batch, like measureService()
+        replies.push_back([arrivals]() {
+            LatencyHistogram& service = BridgeMetrics::getInstance().getProcedure("setParameter");
+            for (auto& arrival : arrivals)
+                service.recordSince(arrival);
+        });
     }
+    parametersToSet.recycle(parameterBatch);
 }
 
-template<typename T>
-void SimulationCallee::traverseGetPath(std::string path, cModule* mod,
-        std::string param, std::list<T>* list) {
-    std::string modPath = "";
-    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
-
-    if (mod != nullptr)
-        modPath = mod->getFullPath();
+void SimulationCallee::setParameters(autobahn::wamp_invocation invocation) {
+    std::vector<ParameterMsg> assignments;
+    for (auto& item : invocation->argument<std::vector<std::tuple<std::string, std::string, std::string>>>(0)) {
+        ParameterMsg msg;
+        msg.moduleName = std::get<0>(item);
+        msg.paramName = std::get<1>(item);
+        msg.value = std::get<2>(item);
+        assignments.push_back(msg);
+    }
 
-    if (path == "") {
-        // Found module, so we set the respective parameter
-        list->push_back(getSingleParameter<T>(mod, param));
-    } else {
-        int pos = path.find(".");
-        std::string firstPart;
-
-        // check if first part is last one in path string
-        if (pos == std::string::npos)
-            firstPart = path;
-        else
-            firstPart = path.substr(0, pos);
-
-        if (firstPart.find("[*]") != std::string::npos) {
-            // call this function for all modules that are part of the array
-            std::string arrayName = firstPart.substr(0, firstPart.find("[*]"));
-            std::string pattern = modPath + "." + arrayName;
-            for (cModule::SubmoduleIterator it(mod); !it.end(); ++it) {
-                cModule *submodule = *it;
-                if (submodule->getFullPath().find(pattern) == 0) {
-                    int newPos = path.find(".");
-                    std::string subPath;
-                    if (newPos == std::string::npos)
-                        subPath = "";
-                    else
-                        subPath = path.substr(newPos + 1, path.size());
-                    traverseGetPath(subPath, submodule, param, list);
-                }
+    enqueue("setParameters", invocation, [invocation, assignments](SimulationCallee& callee, std::vector<Reply>& replies) {
+        std::vector<std::string> statuses;
+        bool valid = true;
+        std::vector<cModule*> modules;
+        for (auto& assignment : assignments) {
+            std::string status;
+            modules.clear();
+            try {
+                callee.moduleIndex.resolve(assignment.moduleName, modules);
+            } catch (const std::exception& e) {
+                status = e.what();
             }
-        } else {
-            // Found a new path part that is not an array.
-
-            // Check if it is the first path part
-            if (mod != nullptr)
-                modPath += "." + firstPart;
-            else
-                modPath = firstPart;
+            if (status.empty() && modules.empty())
+                status = "Module not found";
+            for (size_t i = 0; i < modules.size() && status.empty(); ++i)
+                status = validateParameter(modules[i], assignment.paramName, assignment.value);
+            valid &= status.empty();
+            statuses.push_back(status);
+        }
 
-            // Call this function again with new parameters.
-            cModule *ParamModule = sim->getModuleByPath(modPath.c_str());
-            std::string subPath;
-            if (pos == std::string::npos)
-                subPath = "";
-            else
-                subPath = path.substr(pos + 1, path.size());
+        // all or nothing, so a run never continues with half of a reconfiguration
+        for (size_t i = 0; i < assignments.size(); ++i) {
+            if (valid) {
+                callee.setParameterOnPath(assignments[i].moduleName, assignments[i].paramName, assignments[i].value);
+                statuses[i] = "ok";
+            } else if (statuses[i].empty()) {
+                statuses[i] = "not applied";
+            }
+        }
+        replies.push_back(makeReply(invocation, statuses));
+    });
+}
 
-            if (ParamModule != nullptr)
-                traverseGetPath(subPath, ParamModule, param, list);
+void SimulationCallee::getParameter(autobahn::wamp_invocation invocation) {
+    std::string module = invocation->argument<std::string>(0);
+    std::string paramName = invocation->argument<std::string>(1);
 
+    enqueue("getParameter", invocation, [invocation, module, paramName](SimulationCallee& callee, std::vector<Reply>& replies) {
+        // the first addressed module determines the type of the results
+        std::vector<cModule*> modules;
+        callee.moduleIndex.resolve(module, modules);
+        cModule *mod = modules.empty() ? nullptr : modules.front();
+        if (mod != nullptr) {
+            if (mod->hasPar(paramName.c_str())) {
+                if (mod->par(paramName.c_str()).isExpression()) {
+                    std::string res =
+                            mod->par(paramName.c_str()).getExpression()->str();
+                    res = "=" + res;
+                    replies.push_back(makeReply(invocation, std::make_tuple(res)));
+                } else {
+                    omnetpp::cPar::Type type =
+                            mod->par(paramName.c_str()).getType();
+                    if (type == 'D') {
+                        std::list<double> results_d;
+                        callee.getParameterOnPath(module, paramName, &results_d);
+                        replies.push_back(makeReply(invocation, results_d));
+                    } else if (type == 'S') {
+                        std::list<const char*> results_s;
+                        callee.getParameterOnPath(module, paramName, &results_s);
+                        // copied, the reply is sent after the module may have changed
+                        std::list<std::string> copies;
+                        for (const char *result : results_s)
+                            copies.push_back(result != nullptr ? result : "");
+                        replies.push_back(makeReply(invocation, copies));
+                    } else if (type == 'L') {
+                        std::list<long> results_l;
+                        callee.getParameterOnPath(module, paramName, &results_l);
+                        replies.push_back(makeReply(invocation, results_l));
+                    } else if (type == 'B') {
+                        std::list<bool> results_b;
+                        callee.getParameterOnPath(module, paramName, &results_b);
+                        replies.push_back(makeReply(invocation, results_b));
+                    }
+                }
+            } else {
+                replies.push_back(makeReply(invocation, std::make_tuple("Parameter not found")));
+            }
+        } else {
+            replies.push_back(makeReply(invocation, std::make_tuple("Module not found")));
         }
-    }
+    });
+}
+
+template<typename T>
+void SimulationCallee::getParameterOnPath(const std::string& path, const std::string& param,
+        std::list<T>* list) const {
+    std::vector<cModule*> modules;
+    moduleIndex.resolve(path, modules);
+    for (cModule *mod : modules)
+        list->push_back(getSingleParameter<T>(mod, param));
 }
 
 template<typename T>
@@ -220,40 +527,130 @@ T SimulationCallee::getSingleParameter(cModule* mod, std::string paramName) {
         result = mod->par(paramName.c_str());
         return result;
     } else
-        return 0;
+        return T();
 }
 
 void SimulationCallee::handleParameterChange(const char *parname) {
-    setParameterPath = par("setParameterPath").stringValue();
-    getParameterPath = par("getParameterPath").stringValue();
-    getAllSubmodulesPath = par("getAllSubmodulesPath").stringValue();
-    getParameterNamesPath = par("getParameterNamesPath").stringValue();
+    readProcedurePaths();
     interval = par("setParameterInterval").doubleValue();
     SimulationCallee::calleeModulePath = par("modulePath").stringValue();
+    if (wampConnection != nullptr && parname != nullptr
+            && (strcmp(parname, "heartbeatTopic") == 0 || strcmp(parname, "heartbeatInterval") == 0))
+        startHeartbeat();
     if (par("stopSimulation").boolValue() == true) {
         endSimulation();
     }
 }
 
-void SimulationCallee::initialize(int stage) {
-    cSimpleModule::initialize(stage);
-
+void SimulationCallee::readProcedurePaths() {
     setParameterPath = par("setParameterPath").stringValue();
+    setParametersPath = par("setParametersPath").stringValue();
     getParameterPath = par("getParameterPath").stringValue();
     getAllSubmodulesPath = par("getAllSubmodulesPath").stringValue();
     getParameterNamesPath = par("getParameterNamesPath").stringValue();
+    getSnapshotPath = par("getSnapshotPath").stringValue();
+    watchParameterPath = par("watchParameterPath").stringValue();
+    unwatchParameterPath = par("unwatchParameterPath").stringValue();
+    pausePath = par("pausePath").stringValue();
+    resumePath = par("resumePath").stringValue();
+    stepPath = par("stepPath").stringValue();
+    runUntilPath = par("runUntilPath").stringValue();
+    setRealTimePath = par("setRealTimePath").stringValue();
+    getRunStatePath = par("getRunStatePath").stringValue();
+    getMetricsPath = par("getMetricsPath").stringValue();
+
+    // parallel runs of a sweep register the same procedures, each in the namespace of its run
+    for (std::string *path : {&setParameterPath, &setParametersPath, &getParameterPath, &getAllSubmodulesPath,
+            &getParameterNamesPath, &getSnapshotPath, &watchParameterPath, &unwatchParameterPath, &pausePath,
+            &resumePath, &stepPath, &runUntilPath, &setRealTimePath, &getRunStatePath, &getMetricsPath})
+        *path = RunRegistry::qualify(*path);
+}
+
+void SimulationCallee::startHeartbeat() {
+    std::string topic = RunRegistry::qualify(par("heartbeatTopic").stdstringValue());
+    // each partition reports its own progress
+    if (partitionRouter.isPartitioned())
+        topic = PartitionRouter::shardUri(topic, partitionRouter.getPartitionId());
+    heartbeat.start(topic, par("heartbeatInterval").doubleValue());
+}
+
+void SimulationCallee::initialize(int stage) {
+    cSimpleModule::initialize(stage);
 
+    readProcedurePaths();
     interval = par("setParameterInterval").doubleValue();
 
-    cMessage* msg = new cMessage("interval");
-    scheduleAt(simTime() + interval, msg);
+    moduleIndex.build(getSimulation()->getSystemModule());
 
-    wampConnection.start([&](std::shared_ptr<autobahn::wamp_session> session){
+    WAMPScheduler *scheduler = WAMPScheduler::getActive();
+    if (scheduler != nullptr) {
+        // the scheduler applies the requests between events, no polling needed
+        schedulerHandlerId = scheduler->addHandler([this]() {processPendingRequests();});
+        schedulerTickerId = scheduler->addTicker([this]() {heartbeat.tick();});
+    } else {
+        cMessage* msg = new cMessage("interval");
+        scheduleAt(simTime() + interval, msg);
+    }
+
+    wampConnection = &ConnectionManager::getInstance().acquire(getFullPath());
+    // left from a previous run, their procedures were registered by another callee
+    rejectPendingRequests("The simulation was restarted");
+    accepting = true;
+    parameterChangedTopic = RunRegistry::qualify(par("parameterChangedTopic").stdstringValue());
+    parameterWatcher.start(getSimulation()->getSystemModule(), &moduleIndex, wampConnection, parameterChangedTopic);
+    partitionRouter.start(wampConnection);
+    startHeartbeat();
+    setupId = wampConnection->addSetup([&](WAMPConnection& connection){
+        std::vector<std::pair<std::string, autobahn::wamp_procedure>> procedures = {
+            {setParameterPath, &(setParameter)},
+            {setParametersPath, &(setParameters)},
+            {getParameterPath, &(getParameter)},
+            {getAllSubmodulesPath, &(getSubmodules)},
+            {getParameterNamesPath, &(getModuleParameterNames)},
+            {getSnapshotPath, &(getSnapshot)},
+            {watchParameterPath, &(watchParameter)},
+            {unwatchParameterPath, &(unwatchParameter)},
+            {pausePath, &(pause)},
+            {resumePath, &(resume)},
+            {stepPath, &(step)},
+            {runUntilPath, &(runUntil)},
+            {setRealTimePath, &(setRealTime)},
+            {getRunStatePath, &(getRunState)},
+            {getMetricsPath, &(getMetrics)}
+        };
+
+        std::vector<std::pair<std::string, autobahn::wamp_procedure>> provided;
+        if (partitionRouter.isPartitioned()) {
+            // every partition answers for its own modules under its shard
+            for (auto& procedure : procedures)
+                provided.push_back(std::make_pair(PartitionRouter::shardUri(procedure.first,
+                        partitionRouter.getPartitionId()), procedure.second));
+            if (partitionRouter.getPartitionId() == 0) {
+                for (auto& procedure : procedures) {
+                    if (procedure.first == setParameterPath)
+                        procedure.second = &(routeSetParameter);
+                    else if (procedure.first == getParameterPath)
+                        procedure.second = &(routeGetParameter);
+                    provided.push_back(procedure);
+                }
+            }
+        } else {
+            provided = procedures;
+        }
+
+        // all registrations are issued at once on the I/O thread, then awaited here
         std::vector<boost::future<autobahn::wamp_registration>> registrations;
-        registrations.push_back(session->provide(SimulationCallee::setParameterPath, &(setParameter)));
-        registrations.push_back(session->provide(SimulationCallee::getParameterPath, &(getParameter)));
-        registrations.push_back(session->provide(SimulationCallee::getAllSubmodulesPath, &(getSubmodules)));
-        registrations.push_back(session->provide(SimulationCallee::getParameterNamesPath, &(getModuleParameterNames)));
+        try {
+            registrations = connection.request([&provided](std::shared_ptr<autobahn::wamp_session> session) {
+                std::vector<boost::future<autobahn::wamp_registration>> issued;
+                for (auto& procedure : provided)
+                    issued.push_back(session->provide(procedure.first, procedure.second));
+                return issued;
+            });
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
 
         for(auto& registration : registrations) {
             try {
@@ -269,103 +666,125 @@ void SimulationCallee::initialize(int stage) {
 }
 
 void SimulationCallee::finish() {
-    wampConnection.stop();
-    wampConnection.join();
+    recordMetrics();
+    parameterWatcher.stop();
+    heartbeat.stop();
+    detachScheduler();
+    releaseConnection();
+    moduleIndex.clear();
 }
 
-void SimulationCallee::handleMessage(cMessage *msg) {
+void SimulationCallee::recordMetrics() {
+    std::vector<ConnectionCounters> connections = ConnectionManager::getInstance().getCounters();
+    for (size_t i = 0; i < connections.size(); ++i) {
+        std::string prefix = "bridge.connection" + std::to_string(i) + ".";
+        for (auto& counter : connections[i].toMap())
+            recordScalar((prefix + counter.first).c_str(), counter.second);
+    }
 
-    while(!ParametersToSet.empty()){
-        ParameterMsg *myMsg;
-        ParametersToSet.pop(myMsg);
-        std::string wholePath = myMsg->moduleName;
-        traverseSetPath(wholePath, nullptr, myMsg->paramName, myMsg->value);
+    // the counters are always kept, the latencies only with wamp-metrics
+    if (!BridgeMetrics::getInstance().isEnabled())
+        return;
+    for (auto& latency : BridgeMetrics::getInstance().summarize()) {
+        const LatencyHistogram::Summary& summary = latency.second;
+        if (std::get<0>(summary) == 0)
+            continue;
+        std::string prefix = "bridge." + latency.first + ".";
+        recordScalar((prefix + "count").c_str(), std::get<0>(summary));
+        recordScalar((prefix + "mean").c_str(), std::get<1>(summary), "us");
+        recordScalar((prefix + "p50").c_str(), std::get<2>(summary), "us");
+        recordScalar((prefix + "p99").c_str(), std::get<3>(summary), "us");
+        recordScalar((prefix + "max").c_str(), std::get<4>(summary), "us");
     }
+}
+
+void SimulationCallee::handleMessage(cMessage *msg) {
+    processPendingRequests();
+    heartbeat.tick();
     scheduleAt(simTime() + interval, msg);
 }
 
-void SimulationCallee::traverseSetPath(std::string path, cModule* mod,
-        std::string param, std::string value) {
-    std::string modPath = "";
-    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
+void SimulationCallee::processPendingRequests() {
+    Enter_Method_Silent();
 
-    if (mod != nullptr) {
-        modPath = mod->getFullPath();
-    }
+    // without a connection the replies could not be sent, the requests wait for rejectPendingRequests()
+    if (wampConnection == nullptr)
+        return;
 
-    if (path == "") {
-        // Found module, so we set the respective parameter
-        setSingleParameter(mod, param, value);
-    } else {
-        int pos = path.find(".");
-        std::string firstPart;
-
-        // check if first part is last one in path string
-        if (pos == std::string::npos)
-            firstPart = path;
-        else
-            firstPart = path.substr(0, pos);
-
-        if (firstPart == "*") {
-            // check if the first module was given as star
-            if (mod == nullptr) {
-                mod = sim->getSystemModule();
-                int newPos = path.find(".");
-                std::string subPath;
-                if (newPos == std::string::npos)
-                    subPath = "";
-                else
-                    subPath = path.substr(newPos + 1, path.size());
-                traverseSetPath(subPath, mod, param, value);
-            } else {
-                // call this function for all submodules
-                for (cModule::SubmoduleIterator it(mod); !it.end(); ++it) {
-                    cModule *submodule = *it;
-                    int newPos = path.find(".");
-                    std::string subPath;
-                    if (newPos == std::string::npos)
-                        subPath = "";
-                    else
-                        subPath = path.substr(newPos + 1, path.size());
-                    traverseSetPath(subPath, submodule, param, value);
-                }
-            }
-        } else if (firstPart.find("[*]") != std::string::npos) {
-            // call this function for all modules that are part of the array
-            std::string arrayName = firstPart.substr(0, firstPart.find("[*]"));
-            std::string pattern = modPath + "." + arrayName;
-            for (cModule::SubmoduleIterator it(mod); !it.end(); ++it) {
-                cModule *submodule = *it;
-                if (submodule->getFullPath().find(pattern) == 0) {
-                    int newPos = path.find(".");
-                    std::string subPath;
-                    if (newPos == std::string::npos)
-                        subPath = "";
-                    else
-                        subPath = path.substr(newPos + 1, path.size());
-                    traverseSetPath(subPath, submodule, param, value);
-                }
-            }
-        } else {
-            // Found a new path part that is not a star or an array.
-
-            // Check if it is the first path part
-            if (mod != nullptr)
-                modPath += "." + firstPart;
-            else
-                modPath = firstPart;
-
-            // Call this function again with new parameters.
-            cModule *ParamModule = sim->getModuleByPath(modPath.c_str());
-            std::string subPath;
-            if (pos == std::string::npos)
-                subPath = "";
-            else
-                subPath = path.substr(pos + 1, path.size());
-            if (ParamModule != nullptr)
-                traverseSetPath(subPath, ParamModule, param, value);
+    std::shared_ptr<std::vector<Reply>> replies = std::make_shared<std::vector<Reply>>();
+
+    requests.take(batch);
+    size_t next = 0;
+    try {
+        for (; next < batch.size(); ++next) {
+            // writes take effect before the requests that arrived after them
+            if (!batch[next].write)
+                applyQueuedParameters(*replies);
+            batch[next].request(*this, *replies);
+        }
+        applyQueuedParameters(*replies);
+    } catch (const omnetpp::cTerminationException& e) {
+        // the request that ended the run and the ones after it get no regular answer
+        for (; next < batch.size(); ++next) {
+            if (batch[next].invocation)
+                replies->push_back(makeError(batch[next].invocation, "The simulation ended before the request completed"));
         }
+        batch.clear();
+        postReplies(replies);
+        throw;
     }
+    batch.clear();
+    postReplies(replies);
+}
+
+void SimulationCallee::postReplies(const std::shared_ptr<std::vector<Reply>>& replies) {
+    if (replies->empty() || wampConnection == nullptr)
+        return;
+
+    // one hand-off to the I/O thread for the whole batch
+    wampConnection->post([replies]() {
+        for (auto& reply : *replies)
+            runReply(reply);
+    });
+}
+
+void SimulationCallee::rejectPendingRequests(const std::string& reason) {
+    std::shared_ptr<std::vector<Reply>> replies = std::make_shared<std::vector<Reply>>();
+    requests.take(batch);
+    for (auto& request : batch) {
+        if (request.invocation)
+            replies->push_back(makeError(request.invocation, reason));
+    }
+    batch.clear();
+
+    parametersToSet.take(parameterBatch);
+    for (ParameterQueue::Entry *entry : parameterBatch) {
+        for (auto& invocation : entry->invocations)
+            replies->push_back(makeError(invocation, reason));
+    }
+    parametersToSet.recycle(parameterBatch);
+    postReplies(replies);
+}
+
+void SimulationCallee::sendReply(const Reply& reply) {
+    if (wampConnection != nullptr)
+        wampConnection->post([reply]() {runReply(reply);});
+}
+
+void SimulationCallee::runReply(const Reply& reply) {
+    try {
+        reply();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void SimulationCallee::setParameterOnPath(const std::string& path, const std::string& param,
+        const std::string& value) {
+    std::vector<cModule*> modules;
+    moduleIndex.resolve(path, modules);
+    for (cModule *mod : modules)
+        setSingleParameter(mod, param, value);
 }
 
 void SimulationCallee::setSingleParameter(cModule* mod, std::string paramName,
@@ -401,6 +820,43 @@ void SimulationCallee::setSingleParameter(cModule* mod, std::string paramName,
     }
 }
 
+std::string SimulationCallee::validateParameter(cModule* mod, const std::string& paramName,
+        const std::string& value) {
+    if (!mod->hasPar(paramName.c_str()))
+        return "Parameter not found in " + mod->getFullPath();
+
+    // the same branches as setSingleParameter
+    cPar& par = mod->par(paramName.c_str());
+    bool valueIsExpression = value.find("=") == 0;
+    std::string plain = valueIsExpression ? value.substr(1) : value;
+    try {
+        if (valueIsExpression && (par.isExpression() || par.isVolatile())) {
+            cDynamicExpression expression;
+            expression.parse(plain.c_str());
+            return "";
+        }
+
+        // other parameters take the value without "=", with the conversions of setParameterByDataType
+        switch (par.getType()) {
+        case 'D':
+            std::stod(plain);
+            break;
+        case 'L':
+            std::stol(plain);
+            break;
+        case 'B':
+            if (plain != "true" && plain != "false")
+                return "Invalid bool value " + plain;
+            break;
+        default:
+            break;
+        }
+    } catch (const std::exception& e) {
+        return "Invalid value " + value + ": " + e.what();
+    }
+    return "";
+}
+
 void SimulationCallee::setParameterByDataType(cModule* mod,
         std::string paramName, std::string value) {
     omnetpp::cPar::Type type = mod->par(paramName.c_str()).getType();
@@ -425,8 +881,7 @@ void SimulationCallee::setParameterByDataType(cModule* mod,
         break;
 
     }
-    std::cout << "new " << paramName << " in " << mod->getFullPath() << " is "
-            << value << endl;
+    EV_INFO << "new " << paramName << " in " << mod->getFullPath() << " is " << value << endl;
 }
 
 } /* namespace wampinterfaceforomnetpp */
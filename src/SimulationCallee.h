@@ -20,9 +20,21 @@
 #include <autobahn/autobahn.hpp>
 #include <autobahn/wamp_publish_options.hpp>
 #include "ParameterMsg.h"
-#include <boost/lockfree/queue.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <vector>
 
-#include "WAMPConnection.h"
+#include "BridgeMetrics.h"
+#include "ConnectionManager.h"
+#include "ModuleIndex.h"
+#include "ParameterQueue.h"
+#include "ParameterWatcher.h"
+#include "PartitionRouter.h"
+#include "ProgressHeartbeat.h"
+#include "RequestQueue.h"
+#include "WAMPScheduler.h"
 
 using namespace omnetpp;
 
@@ -38,6 +50,11 @@ private:
      */
     std::string setParameterPath;
 
+    /**
+     * Variable that defines under which name the setParameters function can be found on the WAMP router.
+     */
+    std::string setParametersPath;
+
     /**
      * Variable that defines under which name the getParameter function can be found on the WAMP router.
      */
@@ -53,11 +70,43 @@ private:
      */
     std::string getParameterNamesPath;
 
+    /**
+     * Variable that defines under which name the getSnapshot function can be found on the WAMP router.
+     */
+    std::string getSnapshotPath;
+
+    /**
+     * Variables that define under which names the watchParameter and unwatchParameter functions
+     * can be found on the WAMP router.
+     */
+    std::string watchParameterPath;
+    std::string unwatchParameterPath;
+
+    /**
+     * Variables that define under which names the run control functions can be found on the WAMP router.
+     */
+    std::string pausePath;
+    std::string resumePath;
+    std::string stepPath;
+    std::string runUntilPath;
+    std::string setRealTimePath;
+    std::string getRunStatePath;
+
+    /**
+     * Variable that defines under which name the getMetrics function can be found on the WAMP router.
+     */
+    std::string getMetricsPath;
+
     /**
      * The time between to setParameters Events, that are used to change parameters.
      */
     double interval;
 
+    /**
+     * Reads the names of the procedures from the parameters and puts them into the namespace of the run.
+     */
+    void readProcedurePaths();
+
     /**
      * Defines what happens if the modules parameters change.
      *
@@ -66,30 +115,25 @@ private:
     virtual void handleParameterChange(const char *parname);
 
     /**
-     * Traverses the module path to find all modules where the parameter shall be changed.
+     * Changes the parameter in all modules addressed by the path.
+     * The path is a ModuleSelector, e.g. "net.host[0..499].app[*].*".
      *
-     * @param path      Remaining part of the path that is not already part of the module path.
-     * @param mod       Module, that submodules are looked at.
-     *                  Nullptr if the function is called with the whole path.
+     * @param path      The module path.
      * @param param     The parameter that shall be changed
      * @param value     The value to that the parameter shall be changed.
      */
-    void traverseSetPath(std::string path, cModule* mod, std::string param,
-            std::string value);
+    void setParameterOnPath(const std::string& path, const std::string& param, const std::string& value);
 
     /**
-     * Traverses the get path to return all needed parameter values.
+     * Reads the parameter of all modules addressed by the path.
      * A parameter array is returned, if an array of modules was addressed.
      *
-     * @param path      Remaining part of the path that is not already part of the module path.
-     * @param mod       Module, that submodules are looked at.
-     *                  Nullptr if the function is called with the whole path.
+     * @param path      The module path.
      * @param param     The parameter that shall be read
      * @param list      The list where the results shall be stored.
      */
     template<typename T>
-    static void traverseGetPath(std::string path, cModule* mod,
-            std::string param, std::list<T>* list);
+    void getParameterOnPath(const std::string& path, const std::string& param, std::list<T>* list) const;
 
     /**
      * Checks whether the parameter and/or the value is volatile
@@ -101,6 +145,17 @@ private:
      */
     void setSingleParameter(cModule* mod, std::string paramName,
             std::string value);
+    /**
+     * Checks whether setSingleParameter can set the parameter of the module to the value.
+     * Returns an empty string if it can, otherwise the reason why not.
+     *
+     * @param mod       The module where the parameter shall be changed
+     * @param paramName The parameter that shall be changed
+     * @param value     The value the parameter shall get
+     */
+    static std::string validateParameter(cModule* mod, const std::string& paramName,
+            const std::string& value);
+
     /**
      * Sets the given parameter in the given module to the given value.
      *
@@ -127,9 +182,44 @@ public:
     static std::string calleeModulePath;
 
     /**
-     * Thread- safe boost queue to hold all parameters that shall be changed in the next Simulation Callee event.
+     * Completes a request on the I/O thread, e.g. by sending the result of an invocation.
+     */
+    typedef std::function<void()> Reply;
+
+    /**
+     * Work of a remote procedure that has to run on the simulation thread.
+     * It adds the replies to be sent to the given vector.
+     */
+    typedef std::function<void(SimulationCallee& callee, std::vector<Reply>& replies)> Request;
+
+    /**
+     * A queued request and the invocation it answers.
+     */
+    struct QueuedRequest {
+        /**
+         * Answered with an error if the request is not run, nullptr for work that answers nobody.
+         */
+        autobahn::wamp_invocation invocation;
+        Request request;
+
+        /**
+         * True for the writes of setParameter, which are collected and applied right before the
+         * next request that is not a write, so adjacent writes of a parameter coalesce.
+         */
+        bool write;
+    };
+
+    /**
+     * Requests of all procedures, run in one batch by processPendingRequests() in the order they arrived.
+     * The procedures only parse their arguments on the I/O thread, reading and writing
+     * the module tree is left to the simulation thread.
+     */
+    static RequestQueue<QueuedRequest> requests;
+
+    /**
+     * Routes setParameter and getParameter between the partitions of a parallel simulation.
      */
-    static boost::lockfree::queue<ParameterMsg*> ParametersToSet;
+    static PartitionRouter partitionRouter;
 
     /**
      * Defines the static function that is registered at the crossbar.io server to be called
@@ -141,6 +231,16 @@ public:
      */
     static void setParameter(autobahn::wamp_invocation invocation);
 
+    /**
+     * Function that is registered at the crossbar.io router to change many parameters at once.
+     * All assignments are validated first and only applied if all of them are valid,
+     * then together in the same event. Returns a status for each assignment:
+     * "ok", the reason why it is invalid, or "not applied" if another one was invalid.
+     *
+     * @param invocation    An array of (module, parameter, value) assignments.
+     */
+    static void setParameters(autobahn::wamp_invocation invocation);
+
     /**
      * Function that is registeres at the crossbar.io router to be called to read any parameter of the simulation.
      *
@@ -163,6 +263,78 @@ public:
      */
     static void getModuleParameterNames(autobahn::wamp_invocation invocation);
 
+    /**
+     * Function that is registered at the crossbar.io router to get the module tree with all parameters in one call.
+     * Each module is described as (path, type, [(name, type, unit, value), ...]). The whole tree is read in a
+     * single event. If the caller asked for progressive results, the modules are sent in chunks as they are
+     * read, with the last chunk as final result, otherwise all modules are returned at once. Chunks keep each
+     * message small, but they are queued for the I/O thread without waiting, so the tree may still be held in
+     * memory as a whole until they are sent.
+     *
+     * @param invocation    The arguments given to the function: the path of the root module ("" for the
+     *                      network), optionally the depth (negative for unlimited, 0 for the root only)
+     *                      and the number of modules per chunk.
+     */
+    static void getSnapshot(autobahn::wamp_invocation invocation);
+
+    /**
+     * Function that is registered at the crossbar.io router to be notified about parameter changes.
+     * Returns the id of the watch and the topic of its events, see ParameterWatcher.
+     *
+     * @param invocation    The arguments given to the function: a module selector and a parameter name ("*" for all).
+     */
+    static void watchParameter(autobahn::wamp_invocation invocation);
+
+    /**
+     * Function that is registered at the crossbar.io router to remove a watch. Returns whether it existed.
+     *
+     * @param invocation    The arguments given to the function: the id returned by watchParameter.
+     */
+    static void unwatchParameter(autobahn::wamp_invocation invocation);
+
+    /**
+     * Functions that are registered at the crossbar.io router to control the run, see WAMPScheduler.
+     * They need scheduler-class = "wampinterfaceforomnetpp::WAMPScheduler" and return the run state
+     * (mode, simulation time, event number, real-time pacing, real-time factor) after the change.
+     * pause and resume take no arguments, step optionally the number of events (default 1),
+     * runUntil the simulation time (e.g. "100s") and setRealTime whether to pace the events
+     * and optionally the simulation seconds per wall-clock second (default 1).
+     *
+     * @param invocation    The arguments given to the function.
+     */
+    static void pause(autobahn::wamp_invocation invocation);
+    static void resume(autobahn::wamp_invocation invocation);
+    static void step(autobahn::wamp_invocation invocation);
+    static void runUntil(autobahn::wamp_invocation invocation);
+    static void setRealTime(autobahn::wamp_invocation invocation);
+
+    /**
+     * Function that is registered at the crossbar.io router to read the run state without changing it.
+     *
+     * @param invocation    No arguments.
+     */
+    static void getRunState(autobahn::wamp_invocation invocation);
+
+    /**
+     * Function that is registered at the crossbar.io router to read the metrics of the WAMP bridge,
+     * see BridgeMetrics. It is answered on the I/O thread, so it also works while the simulation is busy.
+     * Returns the counters of each connection by name and the latency summaries by name as
+     * (count, mean, p50, p99, max, buckets), in microseconds.
+     *
+     * @param invocation    No arguments.
+     */
+    static void getMetrics(autobahn::wamp_invocation invocation);
+
+    /**
+     * Functions that are registered under the names of setParameter and getParameter by partition 0
+     * of a parallel simulation. They pass the invocation to the partitions that own the addressed
+     * modules, see PartitionRouter.
+     *
+     * @param invocation    The same arguments as for setParameter and getParameter.
+     */
+    static void routeSetParameter(autobahn::wamp_invocation invocation);
+    static void routeGetParameter(autobahn::wamp_invocation invocation);
+
     /**
      * Initializing the thread.
      */
@@ -175,15 +347,195 @@ public:
 
     /**
      * Function to handle all incoming messages.
+     * Only the polling self-message arrives here, it is not used with the WAMPScheduler.
+     * It also ticks the heartbeat, which then comes at most once per polling interval.
      *
      * @param msg   The incoming message
      */
     void handleMessage(cMessage *msg);
 
     /**
-     * Connection to the WAMP router
+     * Runs all queued requests of the remote procedures and hands their replies to the I/O thread at once.
+     * Called by the polling self-message or between events by the WAMPScheduler.
+     */
+    void processPendingRequests();
+
+    SimulationCallee();
+
+    /**
+     * Releases the shared connection if finish() was not reached.
+     */
+    virtual ~SimulationCallee();
+
+    /**
+     * Shared connection to the WAMP router, taken from the ConnectionManager.
+     * Nullptr while the module does not hold a connection.
+     */
+    WAMPConnection* wampConnection;
+
+private:
+    /**
+     * Queues a request and wakes the WAMPScheduler. If the request throws, the invocation
+     * is answered with an error instead.
+     *
+     * @param procedure     Name of the procedure for its service time in the BridgeMetrics.
+     */
+    static void enqueue(const char *procedure, autobahn::wamp_invocation invocation, const Request& request);
+
+    /**
+     * Queues a request and wakes the WAMPScheduler, or answers it with an error right away
+     * if no callee is running that would take it. Called on the I/O threads.
+     */
+    static void submit(const QueuedRequest& queued);
+
+    /**
+     * True while a callee holds the connection and runs the queued requests.
+     */
+    static std::atomic<bool> accepting;
+
+    /**
+     * Returns a reply that records the service time of the procedure, added after the
+     * replies of the call so the time includes the reply being handed to the session.
+     */
+    static Reply measureService(const char *procedure, std::chrono::steady_clock::time_point arrival);
+
+    /**
+     * Records the metrics of the BridgeMetrics and the connections as scalars.
+     */
+    void recordMetrics();
+
+    /**
+     * Description of a parameter in a snapshot: name, type, unit and value.
+     */
+    typedef std::tuple<std::string, std::string, std::string, std::string> ParameterInfo;
+
+    /**
+     * Description of a module in a snapshot: full path, type and parameters.
+     */
+    typedef std::tuple<std::string, std::string, std::vector<ParameterInfo>> ModuleInfo;
+
+    static ModuleInfo describeModule(cModule *module);
+
+    /**
+     * State of the run: mode, simulation time, event number, real-time pacing and real-time factor.
+     */
+    typedef std::tuple<std::string, std::string, int64_t, bool, double> RunState;
+
+    /**
+     * Queues a run control request that changes the scheduler and replies with the run state afterwards.
+     */
+    static void controlRun(const char *procedure, autobahn::wamp_invocation invocation,
+            const std::function<void(WAMPScheduler&)>& change);
+
+    /**
+     * Queues a request that finds the partitions owning the modules of the invocation and either
+     * runs the local procedure or forwards the invocation to the shards of the procedure at path.
+     */
+    static void route(const char *procedure, PartitionRouter::Merge merge, std::string SimulationCallee::*path,
+            autobahn::wamp_procedure local, autobahn::wamp_invocation invocation);
+
+    /**
+     * Hands a reply to the I/O thread right away instead of with the rest of the batch.
+     */
+    void sendReply(const Reply& reply);
+
+    /**
+     * Runs a reply on the I/O thread, logging failures.
+     */
+    static void runReply(const Reply& reply);
+
+    /**
+     * Returns a reply that sends the given result to the caller.
+     */
+    template<typename T>
+    static Reply makeReply(autobahn::wamp_invocation invocation, const T& result);
+
+    /**
+     * Returns a reply that answers the caller with the error of failed requests.
+     */
+    static Reply makeError(autobahn::wamp_invocation invocation, const std::string& message);
+
+    /**
+     * Hands the replies to the I/O thread at once. They are dropped if there is no connection.
+     */
+    void postReplies(const std::shared_ptr<std::vector<Reply>>& replies);
+
+    /**
+     * Resolves the module paths of the requests without walking the module tree.
+     */
+    ModuleIndex moduleIndex;
+
+    /**
+     * Requests taken from the queue, kept to reuse its capacity.
+     */
+    std::vector<QueuedRequest> batch;
+
+    /**
+     * Answers all queued requests with an error instead of running them, e.g. because the run ends.
+     * The replies go out on wampConnection, requests of a previous run are dropped if there is none.
+     */
+    void rejectPendingRequests(const std::string& reason);
+
+    /**
+     * Publishes the changes of the parameters clients watch.
+     */
+    ParameterWatcher parameterWatcher;
+
+    /**
+     * Topic of the parameter change events.
+     */
+    std::string parameterChangedTopic;
+
+    /**
+     * Publishes the progress of the run.
+     */
+    ProgressHeartbeat heartbeat;
+
+    /**
+     * Starts the heartbeat with the topic and interval of the parameters.
+     */
+    void startHeartbeat();
+
+    /**
+     * Writes of setParameter taken from the requests that wait to be applied.
+     */
+    ParameterQueue parametersToSet;
+
+    /**
+     * Parameter writes taken from parametersToSet, kept to reuse its capacity.
+     */
+    std::vector<ParameterQueue::Entry*> parameterBatch;
+
+    /**
+     * Applies the collected writes of setParameter and adds the replies to their invocations.
+     * If a write ends the simulation, the writes after it are answered with an error.
+     */
+    void applyQueuedParameters(std::vector<Reply>& replies);
+
+    /**
+     * Id of the procedure registration setup on wampConnection.
+     */
+    int setupId;
+
+    /**
+     * Id of the request handler on the WAMPScheduler, -1 if the scheduler is not used.
+     */
+    int schedulerHandlerId;
+
+    /**
+     * Id of the heartbeat ticker on the WAMPScheduler, -1 if the scheduler is not used.
+     */
+    int schedulerTickerId;
+
+    /**
+     * Removes the request handler and the heartbeat ticker from the WAMPScheduler.
+     */
+    void detachScheduler();
+
+    /**
+     * Removes the registration setup and hands the connection back to the ConnectionManager.
      */
-    WAMPConnection wampConnection;
+    void releaseConnection();
 };
 
 } /* namespace wampinterfaceforomnetpp */
@@ -0,0 +1,116 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Preallocated single-producer/single-consumer ring buffer.
+ *
+ * The slots are created once and reused, so a producer that fills a slot in place
+ * (e.g. by assigning to a string member) does not allocate once the slots are warm.
+ * back()/commit() may only be called by the producer thread, front()/popFront()
+ * only by the consumer thread. A producer that shares a lock with the consumer may
+ * also call front()/popFront() to evict the oldest slot.
+ */
+template<typename T>
+class SpscRing {
+public:
+    /**
+     * @param capacity  Number of slots, rounded up to the next power of two.
+     */
+    explicit SpscRing(size_t capacity) :
+            mask(roundUp(capacity) - 1), slots(mask + 1), head(0), tail(0) {
+    }
+
+    /**
+     * Returns the next free slot for the producer or nullptr if the ring is full.
+     * The slot becomes visible to the consumer with commit().
+     */
+    T* back() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask)
+            return nullptr;
+        return &slots[t & mask];
+    }
+
+    /**
+     * Publishes the slot returned by the last back() call.
+     */
+    void commit() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Returns the oldest filled slot for the consumer or nullptr if the ring is empty.
+     */
+    T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots[h & mask];
+    }
+
+    /**
+     * Releases the slot returned by the last front() call to the producer.
+     */
+    void popFront() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    static size_t roundUp(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    const size_t mask;
+    std::vector<T> slots;
+
+    /**
+     * Index of the next slot to read, only written by the consumer.
+     */
+    std::atomic<size_t> head;
+
+    /**
+     * Keeps head and tail on different cache lines.
+     */
+    char padding[64];
+
+    /**
+     * Index of the next slot to write, only written by the producer.
+     */
+    std::atomic<size_t> tail;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* SPSCRING_H_ */
@@ -1,6 +1,8 @@
 #include "WAMPConnection.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <boost/asio/ip/address.hpp>
 #include <boost/program_options.hpp>
 #include <iostream>
@@ -12,10 +14,32 @@ const boost::asio::ip::address ROUTER_IP_ADDRESS(
 const std::string DEFAULT_REALM("opplive");
 const uint16_t DEFAULT_RAWSOCKET_PORT(9000);
 const std::string DEFAULT_UDS_PATH("/tmp/crossbar.sock");
+const double DEFAULT_INITIAL_RETRY_DELAY(0.5);
+const double DEFAULT_MAX_RETRY_DELAY(30);
+const size_t DEFAULT_REPLAY_CAPACITY(10000);
+
+/**
+ * Session that reports the loss of its transport, which autobahn does not expose otherwise.
+ */
+class SupervisedSession : public autobahn::wamp_session {
+public:
+    SupervisedSession(boost::asio::io_service& io, bool debug,
+            const std::function<void(autobahn::wamp_session*)>& onDetached) :
+            autobahn::wamp_session(io, debug), onDetached(onDetached) {
+    }
+
+    virtual void on_detach(bool was_clean, const std::string& reason) override {
+        autobahn::wamp_session::on_detach(was_clean, reason);
+        onDetached(this);
+    }
+
+private:
+    std::function<void(autobahn::wamp_session*)> onDetached;
+};
 }
 
 WAMPConnection::WAMPConnection() :
-             debug(false), running(false), realm(DEFAULT_REALM), rawsocket_endpoint(ROUTER_IP_ADDRESS, DEFAULT_RAWSOCKET_PORT)
+             nextSetupId(0), debug(false), running(false), joined(false), stopPending(false), realm(DEFAULT_REALM), transport(TCP), host(ROUTER_IP_ADDRESS_STRING), port(DEFAULT_RAWSOCKET_PORT), rawsocket_endpoint(ROUTER_IP_ADDRESS, DEFAULT_RAWSOCKET_PORT), initialRetryDelay(DEFAULT_INITIAL_RETRY_DELAY), maxRetryDelay(DEFAULT_MAX_RETRY_DELAY), replayCapacity(DEFAULT_REPLAY_CAPACITY), replayDropped(0), countBytes(false), eventsPublished(0), bytesPublished(0), reconnects(0)
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
 , uds_endpoint(DEFAULT_UDS_PATH)
 #endif
@@ -29,112 +53,319 @@ WAMPConnection::~WAMPConnection() {
     }
 }
 
-void WAMPConnection::start(std::function<bool(std::shared_ptr<autobahn::wamp_session>)> setup) {
-    this->setup = setup;
-    std::cout << "starting" << std::endl;
+void WAMPConnection::configure(Transport transport, const std::string& host, uint16_t port,
+        const std::string& udsPath, const std::string& realm) {
+    assert(!running);
+
+    this->transport = transport;
+    this->host = host;
+    this->port = port;
+    this->realm = realm;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    uds_endpoint = boost::asio::local::stream_protocol::endpoint(udsPath);
+#endif
+}
+
+void WAMPConnection::setRecovery(double initialDelay, double maxDelay, size_t replayCapacity) {
+    assert(!running);
+
+    initialRetryDelay = std::chrono::duration<double>(initialDelay);
+    maxRetryDelay = std::chrono::duration<double>(std::max(initialDelay, maxDelay));
+    this->replayCapacity = replayCapacity;
+}
+
+bool WAMPConnection::supportsUds() {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void WAMPConnection::start() {
     stopPending = false;
+    joined = false;
+    replayDropped = 0;
+    eventsPublished = 0;
+    bytesPublished = 0;
+    reconnects = 0;
     running = true;
+    io.reset(); // allow restarting after a previous stop()
     connecter = std::thread(&WAMPConnection::connect, this);
     runner = std::thread(&WAMPConnection::run, this);
 }
 
+int WAMPConnection::addSetup(std::function<bool(WAMPConnection&)> setup) {
+    std::unique_lock<std::mutex> lock(setupMutex);
+    int id = nextSetupId++;
+    setups.push_back(std::make_pair(id, setup));
+    if(!joined) {
+        // runs in connect() once the realm is joined
+        return id;
+    }
+    lock.unlock();
+
+    bool success = setup(*this);
+    if(!success) {
+        stop();
+    }
+    return id;
+}
+
+void WAMPConnection::removeSetup(int id) {
+    std::lock_guard<std::mutex> lock(setupMutex);
+    for(auto it = setups.begin(); it != setups.end(); ++it) {
+        if(it->first == id) {
+            setups.erase(it);
+            return;
+        }
+    }
+}
+
 void WAMPConnection::stop() {
     assert(running);
 
     stopPending = true;
 
-    boost::future<void> leave_future, stop_future;
+    bool leave;
+    {
+        std::lock_guard<std::mutex> lock(setupMutex);
+        setups.clear();
+        leave = joined;
+        if(!leave) {
+            // nothing to leave, the connecter bails out on stopPending
+            io.stop();
+        }
+    }
+    // wakes the connecter if it waits for a retry or for the session to detach
+    stateChanged.notify_all();
+    if(!leave) {
+        return;
+    }
 
-    leave_future = session->leave().then([&](boost::future<std::string> reason) {
-        try {
-            std::cerr << "left session (" << reason.get() << ")" << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+    // leave on the I/O thread, after everything that was posted before
+    post([this]() {
+        {
+            std::lock_guard<std::mutex> lock(setupMutex);
+            joined = false;
         }
 
-        io.stop();
+        leaving = session->leave().then([this](boost::future<std::string> reason) {
+            try {
+                std::cerr << "left session (" << reason.get() << ")" << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+
+            io.stop();
+        });
     });
 }
 
+void WAMPConnection::post(std::function<void()> handler) {
+    io.post(handler);
+}
+
 void WAMPConnection::join() {
-    runner.join();
-    connecter.join();
+    if(runner.joinable()) {
+        runner.join();
+    }
+    if(connecter.joinable()) {
+        connecter.join();
+    }
 }
 
 void WAMPConnection::exec(std::function<bool(std::shared_ptr<autobahn::wamp_session>)> task) {
-    if(!isRunning()) {
-        start(task);
-    }
-    else {
+    post([this, task]() {
+        if(!isJoined()) {
+            // the session is not usable before the realm is joined
+            return;
+        }
         bool success = task(session);
         if(!success) {
             stop();
         }
-    }
+    });
 }
 
 void WAMPConnection::connect() {
-    try {
-        boost::future<void> connected, started;
-
-        auto transport = std::make_shared<autobahn::wamp_tcp_transport>(io, rawsocket_endpoint, debug);
-
-        session = std::make_shared<autobahn::wamp_session>(io, debug);
+    std::chrono::duration<double> delay = initialRetryDelay;
+    while(!stopPending) {
+        if(establish()) {
+            delay = initialRetryDelay;
 
-        transport->attach(std::static_pointer_cast<autobahn::wamp_transport_handler>(session));
-
-        while(!stopPending) {
-            connected = transport->connect();
-            try {
-                connected.get();
-                std::cout << "transport connected" << std::endl;
-                break;
-            } catch (const std::system_error & e) {
-                if(e.code().value() == boost::asio::error::connection_refused) {
-                    std::cerr << "No connection to WAMP router" << std::endl;
-                    boost::this_thread::sleep_for(boost::chrono::seconds(2));
-                }
-                else {
-                    std::cerr << e.what() << std::endl;
-                    return;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << e.what() << std::endl;
+            std::unique_lock<std::mutex> lock(setupMutex);
+            stateChanged.wait(lock, [this]() {return !joined || stopPending;});
+            if(stopPending) {
                 return;
             }
+            // a restarting router is often back right away, so the first attempt is immediate
+            reconnects++;
+            std::cerr << "lost connection to WAMP router, reconnecting" << std::endl;
+            continue;
         }
 
         if(stopPending) {
             return;
         }
+        std::cerr << "No connection to WAMP router, retrying in " << delay.count() << "s" << std::endl;
+        {
+            std::unique_lock<std::mutex> lock(setupMutex);
+            stateChanged.wait_for(lock, delay, [this]() {return stopPending.load();});
+        }
+        delay = std::min(delay * 2, maxRetryDelay);
+    }
+}
+
+bool WAMPConnection::establish() {
+    // a detached session cannot be restarted, every attempt gets a new one
+    std::shared_ptr<autobahn::wamp_session> candidate;
+    try {
+        // resolved on every attempt, so a router whose address changed or was not yet known is found again
+        if(transport == TCP) {
+            boost::future<void> resolved = resolve();
+            if(!await(resolved)) {
+                return false;
+            }
+        }
+        auto transport = createTransport();
+        candidate = std::make_shared<SupervisedSession>(io, debug, [this](autobahn::wamp_session *detachedSession) {
+            detached(detachedSession);
+        });
 
-        started = session->start();
-        started.get();
-        std::cout << "session started" << std::endl;
+        // the transport and the session are driven by the I/O thread, only the waiting happens here
+        boost::future<void> connected;
+        if(!onIoThread<boost::future<void>>([transport, candidate]() -> boost::future<void> {
+            transport->attach(std::static_pointer_cast<autobahn::wamp_transport_handler>(candidate));
+            return transport->connect();
+        }, connected) || !await(connected)) {
+            return false;
+        }
 
-        auto joined = session->join(realm);
-        joined.get();
-        std::cout << "joined realm" << std::endl;
+        boost::future<void> started;
+        if(!onIoThread<boost::future<void>>([candidate]() {return candidate->start();}, started)
+                || !await(started)) {
+            return false;
+        }
 
-        bool success = setup(session);
-        if(!success) {
-            stop();
+        boost::future<uint64_t> joining;
+        std::string realm = this->realm;
+        if(!onIoThread<boost::future<uint64_t>>([candidate, realm]() {return candidate->join(realm);}, joining)
+                || !await(joining)) {
+            return false;
         }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
+        return false;
     }
+
+    std::vector<std::pair<int, std::function<bool(WAMPConnection&)>>> pending;
+    {
+        std::lock_guard<std::mutex> lock(setupMutex);
+        if(stopPending) {
+            return false;
+        }
+        session = candidate;
+        joined = true;
+        pending = setups;
+    }
+
+    // registrations and subscriptions are gone with the old session, so all setups run again
+    for(auto& setup : pending) {
+        bool success = setup.second(*this);
+        if(!success) {
+            stop();
+            return true;
+        }
+    }
+
+    post([this]() {replay();});
+    return true;
+}
+
+template<typename T>
+bool WAMPConnection::await(boost::future<T>& future) {
+    if(!waitFor(future)) {
+        return false;
+    }
+    future.get();
+    return true;
+}
+
+void WAMPConnection::detached(autobahn::wamp_session *detachedSession) {
+    {
+        std::lock_guard<std::mutex> lock(setupMutex);
+        if(session.get() != detachedSession) {
+            // sessions of failed attempts detach as well
+            return;
+        }
+        if(stopPending) {
+            // the router went away while leaving, the leave will not be answered
+            io.stop();
+            return;
+        }
+        if(!joined) {
+            return;
+        }
+        joined = false;
+    }
+    stateChanged.notify_all();
+}
+
+void WAMPConnection::replay() {
+    while(!replayBuffer.empty() && isJoined()) {
+        ReplayEvent& event = replayBuffer.front();
+        try {
+            session->publish(event.topic, event.arguments);
+            meter(event.arguments);
+        } catch (const std::exception& e) {
+            // detached again, the rest waits for the next session
+            std::cerr << e.what() << std::endl;
+            return;
+        }
+        replayBuffer.pop_front();
+    }
+}
+
+std::shared_ptr<autobahn::wamp_transport> WAMPConnection::createTransport() {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if(transport == UDS) {
+        return std::make_shared<autobahn::wamp_uds_transport>(io, uds_endpoint, debug);
+    }
+#endif
+
+    return std::make_shared<autobahn::wamp_tcp_transport>(io, rawsocket_endpoint, debug);
+}
+
+boost::future<void> WAMPConnection::resolve() {
+    // the handler keeps the resolver alive if await() gives up early
+    auto resolver = std::make_shared<boost::asio::ip::tcp::resolver>(io);
+    auto resolved = std::make_shared<boost::promise<void>>();
+    boost::asio::ip::tcp::resolver::query query(host, std::to_string(port));
+    resolver->async_resolve(query, [this, resolver, resolved](const boost::system::error_code& error,
+            boost::asio::ip::tcp::resolver::iterator endpoints) {
+        if(error) {
+            resolved->set_exception(boost::copy_exception(boost::system::system_error(error, "cannot resolve " + host)));
+        } else if(endpoints == boost::asio::ip::tcp::resolver::iterator()) {
+            resolved->set_exception(boost::copy_exception(std::runtime_error("no address for " + host)));
+        } else {
+            rawsocket_endpoint = *endpoints;
+            resolved->set_value();
+        }
+    });
+    return resolved->get_future();
 }
 
 void WAMPConnection::run() {
-    std::cout << "Running" << std::endl;
     try {
         boost::asio::io_service::work work(io); // avoid leaving run if nothing is left to do
-        std::cout << "starting io service .." << std::endl;
         io.run();
-        std::cout << "stopped io service" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
+    // events of an outage that did not end before the run
+    replayDropped += replayBuffer.size();
+    replayBuffer.clear();
     running = false;
 }
 
@@ -4,19 +4,134 @@
 #include <boost/asio/ip/tcp.hpp>
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
 #    include <boost/asio/local/stream_protocol.hpp>
-#endif 
+#endif
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 #include <autobahn/autobahn.hpp>
 
 class WAMPConnection {
 public:
+    /**
+     * How the connection reaches the router: rawsocket over TCP or over a Unix domain socket.
+     */
+    enum Transport {
+        TCP, UDS
+    };
+
     WAMPConnection();
     ~WAMPConnection();
 
-    void start(std::function<bool(std::shared_ptr<autobahn::wamp_session>)> setup);
+    /**
+     * Sets the router endpoint and realm, used from the next start() on.
+     * Host names are resolved by start(), so they may change between runs.
+     *
+     * @param transport TCP or UDS, UDS is only available where boost supports local sockets.
+     * @param host      Host name or address of the router for TCP.
+     * @param port      Port of the rawsocket transport of the router for TCP.
+     * @param udsPath   Path of the rawsocket transport of the router for UDS.
+     * @param realm     The realm the session joins.
+     */
+    void configure(Transport transport, const std::string& host, uint16_t port, const std::string& udsPath,
+            const std::string& realm);
+
+    /**
+     * True if UDS transports are available on this platform.
+     */
+    static bool supportsUds();
+
+    /**
+     * Sets how the connection recovers from a missing or restarted router, used from the next start() on.
+     *
+     * @param initialDelay      Seconds before the first retry. The delay doubles with every failed attempt.
+     * @param maxDelay          Upper bound of the delay in seconds.
+     * @param replayCapacity    Number of events kept while the session is not joined, 0 drops them.
+     */
+    void setRecovery(double initialDelay, double maxDelay, size_t replayCapacity);
+
+    /**
+     * Publishes an event. Runs on the I/O thread.
+     * While the session is not joined, or events of an outage are still waiting to be replayed,
+     * the event is kept in the replay buffer and published once the session has joined again.
+     * If the buffer is full, its oldest event is dropped.
+     */
+    template<typename List>
+    void publish(const std::string& topic, const List& arguments);
+
+    /**
+     * Number of events that were lost because the replay buffer was full.
+     */
+    uint64_t getReplayDropped() const {
+        return replayDropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Sets whether publish() measures the msgpack size of the event arguments for getBytesPublished().
+     * It packs the arguments a second time, so it is off by default.
+     */
+    void setByteCounting(bool enabled) {
+        countBytes = enabled;
+    }
+
+    /**
+     * Number of events passed to the session since start(), including replayed ones.
+     */
+    uint64_t getEventsPublished() const {
+        return eventsPublished.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * msgpack size of the arguments of the published events, without the WAMP envelope.
+     * Only counted with setByteCounting().
+     */
+    uint64_t getBytesPublished() const {
+        return bytesPublished.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of times the joined session was lost since start().
+     */
+    uint64_t getReconnects() const {
+        return reconnects.load(std::memory_order_relaxed);
+    }
+
+    void start();
+
+    /**
+     * Adds a function that runs every time the realm is joined, e.g. to register procedures, and
+     * right away if the session is already joined. It runs on the connecter thread or the calling
+     * thread and reaches the session through request(). If it returns false, the connection is stopped.
+     * Must not be called on the I/O thread.
+     */
+    int addSetup(std::function<bool(WAMPConnection&)> setup);
+    void removeSetup(int id);
+
+    /**
+     * Runs the task on the I/O thread if the session is joined then, otherwise drops it.
+     * If the task returns false, the connection is stopped. Returns at once, so the task
+     * must not wait for the futures of the session; they are only satisfied by the I/O thread.
+     */
     void exec(std::function<bool(std::shared_ptr<autobahn::wamp_session>)> task);
+
+    /**
+     * Calls issue with the session on the I/O thread and returns what it returned, usually the future
+     * of a call or a registration, so the session is never used by another thread. The returned future
+     * can be waited for. Throws if the session is not joined or the connection stops first.
+     * Blocks until the I/O thread ran issue, so it must not be called on the I/O thread.
+     */
+    template<typename Issue>
+    auto request(Issue issue) -> decltype(issue(std::shared_ptr<autobahn::wamp_session>()));
+
+    void post(std::function<void()> handler);
     void stop();
     void join();
 
@@ -24,10 +139,108 @@ public:
         return running;
     }
 
+    bool isJoined() {
+        return joined;
+    }
+
+    /**
+     * The session, only to be used on the I/O thread and while isJoined().
+     */
+    std::shared_ptr<autobahn::wamp_session> getSession() {
+        return session;
+    }
+
 private:
+    /**
+     * An event published while the session was not joined, converted to msgpack so it does not
+     * refer to the buffers of the publisher.
+     */
+    struct ReplayEvent {
+        std::string topic;
+        std::shared_ptr<msgpack::zone> zone;
+        msgpack::object arguments;
+    };
+
+    /**
+     * Stream for msgpack::packer that only counts the bytes written to it.
+     */
+    struct ByteCounter {
+        uint64_t bytes;
+
+        void write(const char *data, size_t length) {
+            bytes += length;
+        }
+    };
+
     void run();
+
+    /**
+     * Keeps the session joined until stop(): connects, runs the setups, waits for the session
+     * to detach and reconnects, with exponentially growing delays between failed attempts.
+     * Runs on the connecter thread.
+     */
     void connect();
 
+    /**
+     * Makes one attempt to connect and join the realm, and runs the setups on success.
+     * Returns false if the attempt failed or was interrupted by stop().
+     */
+    bool establish();
+
+    /**
+     * Waits for the future while checking for stop(). Returns false if stop() was called.
+     * Rethrows the exception of a failed future.
+     */
+    template<typename T>
+    bool await(boost::future<T>& future);
+
+    /**
+     * Waits until the future is ready without taking its value. Returns false if stop() was called,
+     * since the io_service is stopped then and the future might never become ready.
+     */
+    template<typename T>
+    bool waitFor(boost::future<T>& future);
+
+    /**
+     * Runs issue on the I/O thread and moves its result into result. Returns false if stop() was
+     * called before it ran, rethrows its exception.
+     */
+    template<typename Result>
+    bool onIoThread(std::function<Result()> issue, Result& result);
+
+    /**
+     * Called on the I/O thread when the transport of the session is gone, e.g. because the router restarted.
+     */
+    void detached(autobahn::wamp_session *detachedSession);
+
+    /**
+     * Adds an event to the replay buffer, dropping the oldest one if it is full. Runs on the I/O thread.
+     */
+    template<typename List>
+    void buffer(const std::string& topic, const List& arguments);
+
+    /**
+     * Publishes the buffered events in order. Runs on the I/O thread after the session has joined.
+     */
+    void replay();
+
+    /**
+     * Counts an event passed to the session. Runs on the I/O thread.
+     */
+    template<typename List>
+    void meter(const List& arguments);
+
+    /**
+     * Creates the transport to the configured endpoint. Runs on the connecter thread.
+     */
+    std::shared_ptr<autobahn::wamp_transport> createTransport();
+
+    /**
+     * Resolves the router host into rawsocket_endpoint on the I/O thread. The future fails if
+     * the host cannot be resolved, which establish() treats like a failed connect.
+     */
+    boost::future<void> resolve();
+
     /**
      * io service for establishing a TCP connection to the router.
      */
@@ -44,23 +257,158 @@ private:
     std::thread connecter;
 
     /**
-     * Function for setup after connection
+     * Functions for setup after connection. They are run once the realm is joined,
+     * or immediately if they are added to an already joined connection.
      */
-    std::function<bool(std::shared_ptr<autobahn::wamp_session>)> setup;
+    std::vector<std::pair<int, std::function<bool(WAMPConnection&)>>> setups;
+
+    /**
+     * Id handed out by the next addSetup call.
+     */
+    int nextSetupId;
+
+    /**
+     * Guards setups, session and joined against concurrent addSetup calls and the reconnects.
+     */
+    std::mutex setupMutex;
+
+    /**
+     * Signals the connecter thread that the session detached or stop() was called.
+     */
+    std::condition_variable stateChanged;
 
     /**
      * WAMP Session
      */
     std::shared_ptr<autobahn::wamp_session> session;
 
+    /**
+     * Continuation of the leave request issued by stop()
+     */
+    boost::future<void> leaving;
+
     bool debug;
-    bool running;
-    bool stopPending;
+    std::atomic<bool> running;
+    std::atomic<bool> joined;
+    std::atomic<bool> stopPending;
     std::string realm;
+    Transport transport;
+    std::string host;
+    uint16_t port;
     boost::asio::ip::tcp::endpoint rawsocket_endpoint;
+
+    std::chrono::duration<double> initialRetryDelay;
+    std::chrono::duration<double> maxRetryDelay;
+
+    /**
+     * Events waiting for the session to join, only used on the I/O thread.
+     */
+    std::deque<ReplayEvent> replayBuffer;
+    size_t replayCapacity;
+    std::atomic<uint64_t> replayDropped;
+
+    /**
+     * Only written on the I/O thread, respectively the connecter thread for reconnects.
+     */
+    bool countBytes;
+    std::atomic<uint64_t> eventsPublished;
+    std::atomic<uint64_t> bytesPublished;
+    std::atomic<uint64_t> reconnects;
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
     boost::asio::local::stream_protocol::endpoint uds_endpoint;
 #endif
 };
 
+template<typename List>
+void WAMPConnection::publish(const std::string& topic, const List& arguments) {
+    if (isJoined() && replayBuffer.empty()) {
+        try {
+            session->publish(topic, arguments);
+            meter(arguments);
+            return;
+        } catch (const std::exception& e) {
+            // the transport went away before the session noticed, the event is replayed
+            std::cerr << "publishing to " << topic << " failed: " << e.what() << std::endl;
+        }
+    }
+    buffer(topic, arguments);
+}
+
+template<typename Issue>
+auto WAMPConnection::request(Issue issue) -> decltype(issue(std::shared_ptr<autobahn::wamp_session>())) {
+    typedef decltype(issue(std::shared_ptr<autobahn::wamp_session>())) Result;
+    Result result;
+    bool issued = onIoThread<Result>([this, issue]() -> Result {
+        if (!isJoined())
+            throw std::runtime_error("WAMP session is not joined");
+        return issue(session);
+    }, result);
+    if (!issued)
+        throw std::runtime_error("WAMP connection stopped");
+    return result;
+}
+
+template<typename T>
+bool WAMPConnection::waitFor(boost::future<T>& future) {
+    while (future.wait_for(boost::chrono::milliseconds(100)) != boost::future_status::ready) {
+        if (stopPending)
+            return false;
+    }
+    return true;
+}
+
+template<typename Result>
+bool WAMPConnection::onIoThread(std::function<Result()> issue, Result& result) {
+    // shared with the handler, which may still be queued when the wait gives up
+    auto outcome = std::make_shared<boost::promise<Result>>();
+    auto abandoned = std::make_shared<std::atomic<bool>>(false);
+    boost::future<Result> issued = outcome->get_future();
+    post([outcome, abandoned, issue]() {
+        // a stopped io_service keeps its handlers, they must not run after a restart
+        if (*abandoned)
+            return;
+        try {
+            outcome->set_value(issue());
+        } catch (...) {
+            outcome->set_exception(boost::current_exception());
+        }
+    });
+    if (!waitFor(issued)) {
+        *abandoned = true;
+        return false;
+    }
+    result = issued.get();
+    return true;
+}
+
+template<typename List>
+void WAMPConnection::meter(const List& arguments) {
+    eventsPublished.store(eventsPublished.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (!countBytes)
+        return;
+    ByteCounter counter;
+    counter.bytes = 0;
+    msgpack::packer<ByteCounter> packer(counter);
+    packer.pack(arguments);
+    bytesPublished.store(bytesPublished.load(std::memory_order_relaxed) + counter.bytes, std::memory_order_relaxed);
+}
+
+template<typename List>
+void WAMPConnection::buffer(const std::string& topic, const List& arguments) {
+    if (replayCapacity == 0) {
+        replayDropped++;
+        return;
+    }
+    if (replayBuffer.size() >= replayCapacity) {
+        replayBuffer.pop_front();
+        replayDropped++;
+    }
+
+    ReplayEvent event;
+    event.topic = topic;
+    event.zone = std::make_shared<msgpack::zone>();
+    event.arguments = msgpack::object(arguments, *event.zone);
+    replayBuffer.push_back(event);
+}
+
 #endif
@@ -0,0 +1,217 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "WAMPScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace wampinterfaceforomnetpp {
+
+Register_Class(WAMPScheduler);
+
+std::atomic<bool> WAMPScheduler::pending(false);
+std::mutex WAMPScheduler::mutex;
+std::condition_variable WAMPScheduler::requested;
+
+WAMPScheduler::WAMPScheduler() :
+        nextHandlerId(0), tickCountdown(TICK_EVENTS), runMode(RUNNING), stepsLeft(0), realTime(false), realTimeFactor(1), anchored(false) {
+}
+
+const char *WAMPScheduler::getRunModeName(RunMode mode) {
+    switch (mode) {
+    case PAUSED:
+        return "paused";
+    case STEPPING:
+        return "stepping";
+    case RUNNING_UNTIL:
+        return "running-until";
+    default:
+        return "running";
+    }
+}
+
+WAMPScheduler* WAMPScheduler::getActive() {
+    omnetpp::cSimulation *sim = omnetpp::cSimulation::getActiveSimulation();
+    if (sim == nullptr)
+        return nullptr;
+    return dynamic_cast<WAMPScheduler*>(sim->getScheduler());
+}
+
+void WAMPScheduler::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+    }
+    requested.notify_one();
+}
+
+int WAMPScheduler::addHandler(std::function<void()> handler) {
+    int id = nextHandlerId++;
+    handlers.push_back(std::make_pair(id, handler));
+    return id;
+}
+
+void WAMPScheduler::removeHandler(int id) {
+    for (auto it = handlers.begin(); it != handlers.end(); ++it) {
+        if (it->first == id) {
+            handlers.erase(it);
+            return;
+        }
+    }
+}
+
+int WAMPScheduler::addTicker(std::function<void()> ticker) {
+    int id = nextHandlerId++;
+    tickers.push_back(std::make_pair(id, ticker));
+    return id;
+}
+
+void WAMPScheduler::removeTicker(int id) {
+    for (auto it = tickers.begin(); it != tickers.end(); ++it) {
+        if (it->first == id) {
+            tickers.erase(it);
+            return;
+        }
+    }
+}
+
+void WAMPScheduler::pause() {
+    runMode = PAUSED;
+}
+
+void WAMPScheduler::resume() {
+    runMode = RUNNING;
+}
+
+void WAMPScheduler::step(long events) {
+    if (events < 1)
+        throw omnetpp::cRuntimeError("Number of events to step must be at least 1, got %ld", events);
+    runMode = STEPPING;
+    stepsLeft = events;
+}
+
+void WAMPScheduler::runUntil(omnetpp::simtime_t time) {
+    runMode = RUNNING_UNTIL;
+    stopTime = time;
+}
+
+void WAMPScheduler::setRealTime(bool enabled, double factor) {
+    if (enabled && factor <= 0)
+        throw omnetpp::cRuntimeError("Real-time factor must be positive, got %g", factor);
+    realTime = enabled;
+    realTimeFactor = factor;
+    anchored = false;
+}
+
+void WAMPScheduler::startRun() {
+    omnetpp::cSequentialScheduler::startRun();
+    runMode = RUNNING;
+    stepsLeft = 0;
+    anchored = false;
+    // requests that arrived before the run are picked up by the first event
+    pending = true;
+}
+
+omnetpp::cEvent *WAMPScheduler::takeNextEvent() {
+    processRequests();
+    if (--tickCountdown <= 0) {
+        tickCountdown = TICK_EVENTS;
+        runTickers();
+    }
+
+    while (!handlers.empty()) {
+        if (mustWait()) {
+            // wakes up regularly, so the user interface can stop the run
+            if (!waitForRequests(std::chrono::steady_clock::now() + std::chrono::milliseconds(100)))
+                return nullptr;
+            anchored = false;
+            continue;
+        }
+        if (!realTime)
+            break;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point due = getDueTime(sim->getFES()->peekFirst());
+        if (due <= now)
+            break;
+        // requests may pause the run or end the pacing while waiting for the event
+        if (!waitForRequests(std::min(due, now + std::chrono::milliseconds(100))))
+            return nullptr;
+    }
+
+    omnetpp::cEvent *event = omnetpp::cSequentialScheduler::takeNextEvent();
+    if (event != nullptr && runMode == STEPPING && --stepsLeft == 0)
+        runMode = PAUSED;
+    return event;
+}
+
+bool WAMPScheduler::mustWait() {
+    if (sim->getFES()->isEmpty())
+        return true;
+    switch (runMode) {
+    case PAUSED:
+        return true;
+    case RUNNING_UNTIL:
+        if (sim->getFES()->peekFirst()->getArrivalTime() <= stopTime)
+            return false;
+        runMode = PAUSED;
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::chrono::steady_clock::time_point WAMPScheduler::getDueTime(omnetpp::cEvent *event) {
+    if (!anchored) {
+        anchored = true;
+        anchorWallTime = std::chrono::steady_clock::now();
+        anchorSimTime = sim->getSimTime();
+    }
+    std::chrono::duration<double> offset((event->getArrivalTime() - anchorSimTime).dbl() / realTimeFactor);
+    return anchorWallTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+}
+
+bool WAMPScheduler::waitForRequests(std::chrono::steady_clock::time_point deadline) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        requested.wait_until(lock, deadline, [] {return pending.load();});
+    }
+    processRequests();
+    runTickers();
+    return !omnetpp::getEnvir()->idle();
+}
+
+void WAMPScheduler::processRequests() {
+    // a single flag check per event while no requests arrive
+    if (!pending.load(std::memory_order_acquire))
+        return;
+    pending = false;
+
+    // handlers may remove themselves, e.g. when they end the simulation
+    std::vector<std::pair<int, std::function<void()>>> current(handlers);
+    for (auto& handler : current)
+        handler.second();
+}
+
+void WAMPScheduler::runTickers() {
+    if (tickers.empty())
+        return;
+    std::vector<std::pair<int, std::function<void()>>> current(tickers);
+    for (auto& ticker : current)
+        ticker.second();
+}
+
+} /* namespace wampinterfaceforomnetpp */
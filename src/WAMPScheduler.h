@@ -0,0 +1,197 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef WAMPSCHEDULER_H_
+#define WAMPSCHEDULER_H_
+
+#include <omnetpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace wampinterfaceforomnetpp {
+
+/**
+ * Sequential scheduler that applies remote requests between events.
+ *
+ * Select it with scheduler-class = "wampinterfaceforomnetpp::WAMPScheduler".
+ * The I/O threads call notify() when they queued a request, and the scheduler runs
+ * the registered handlers before it hands out the next event, so remote changes take
+ * effect right away instead of on the next polling interval.
+ * While handlers are registered and the future event set is empty, the scheduler waits
+ * for requests instead of ending the simulation, like the polling self-message did.
+ *
+ * The scheduler also controls the run on behalf of remote clients: it can pause,
+ * execute a number of events, run until a simulation time and pace the events to
+ * wall-clock time. Without pacing, events are handed out as fast as possible.
+ * Run control only applies while handlers are registered, so a run never waits
+ * for requests nobody can send.
+ */
+class WAMPScheduler: public omnetpp::cSequentialScheduler {
+public:
+    /**
+     * What the scheduler does with the next event.
+     *  - running:          hands it out
+     *  - paused:           waits for a request to continue
+     *  - stepping:         hands out a number of events, then pauses
+     *  - running-until:    hands out the events up to a simulation time, then pauses
+     */
+    enum RunMode {
+        RUNNING, PAUSED, STEPPING, RUNNING_UNTIL
+    };
+
+    WAMPScheduler();
+
+    /**
+     * Returns the name of the run mode, e.g. "running-until".
+     */
+    static const char *getRunModeName(RunMode mode);
+
+    /**
+     * Returns the scheduler of the active simulation if it is a WAMPScheduler, nullptr otherwise.
+     */
+    static WAMPScheduler* getActive();
+
+    /**
+     * Wakes the scheduler to run the handlers. Thread safe, called by the I/O threads.
+     */
+    static void notify();
+
+    /**
+     * Registers a function that processes queued requests on the simulation thread.
+     * Returns an id for removeHandler().
+     */
+    int addHandler(std::function<void()> handler);
+    void removeHandler(int id);
+
+    /**
+     * Registers a function that is called on the simulation thread every TICK_EVENTS events and
+     * whenever the scheduler wakes up while it holds the run back, e.g. to do work by wall-clock time.
+     * Returns an id for removeTicker().
+     */
+    int addTicker(std::function<void()> ticker);
+    void removeTicker(int id);
+
+    /**
+     * Number of events between the calls of the tickers.
+     */
+    static const int TICK_EVENTS = 64;
+
+    /**
+     * Run control, called on the simulation thread, e.g. by the handlers.
+     * pause() stops before the next event, resume() continues without limit.
+     * step() executes the given number of events and runUntil() the events up to
+     * and including the given time, both pause afterwards.
+     */
+    void pause();
+    void resume();
+    void step(long events);
+    void runUntil(omnetpp::simtime_t time);
+
+    /**
+     * Paces the events to wall-clock time, factor seconds of simulation time per second.
+     * Without pacing, events are handed out as fast as possible.
+     */
+    void setRealTime(bool enabled, double factor);
+
+    RunMode getRunMode() const {
+        return runMode;
+    }
+
+    /**
+     * Number of events left in stepping mode.
+     */
+    long getStepsLeft() const {
+        return stepsLeft;
+    }
+
+    /**
+     * Time up to which events are executed in running-until mode.
+     */
+    omnetpp::simtime_t getStopTime() const {
+        return stopTime;
+    }
+
+    bool isRealTime() const {
+        return realTime;
+    }
+
+    double getRealTimeFactor() const {
+        return realTimeFactor;
+    }
+
+    virtual void startRun() override;
+    virtual omnetpp::cEvent *takeNextEvent() override;
+
+protected:
+    /**
+     * Runs the handlers if a request was announced since the last call.
+     */
+    void processRequests();
+
+    /**
+     * Returns true if the next event must not be handed out yet, because the future event set
+     * is empty or the run mode holds it back. Switches to paused when a step or run-until is done.
+     */
+    bool mustWait();
+
+    /**
+     * Returns the wall-clock time the event is due at under real-time pacing.
+     */
+    std::chrono::steady_clock::time_point getDueTime(omnetpp::cEvent *event);
+
+    /**
+     * Waits until a request arrives or the deadline passes and runs the handlers.
+     * Returns false if the user interface asked to stop the run.
+     */
+    bool waitForRequests(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Calls the tickers.
+     */
+    void runTickers();
+
+    std::vector<std::pair<int, std::function<void()>>> handlers;
+    std::vector<std::pair<int, std::function<void()>>> tickers;
+    int nextHandlerId;
+    int tickCountdown;
+
+    RunMode runMode;
+    long stepsLeft;
+    omnetpp::simtime_t stopTime;
+
+    bool realTime;
+    double realTimeFactor;
+
+    /**
+     * Wall-clock and simulation time pacing is measured from. Reset whenever the run was held back,
+     * so a pause is not caught up afterwards.
+     */
+    bool anchored;
+    std::chrono::steady_clock::time_point anchorWallTime;
+    omnetpp::simtime_t anchorSimTime;
+
+    static std::atomic<bool> pending;
+    static std::mutex mutex;
+    static std::condition_variable requested;
+};
+
+} /* namespace wampinterfaceforomnetpp */
+
+#endif /* WAMPSCHEDULER_H_ */
@@ -0,0 +1,87 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+// Checks that the batch of a topic that stops emitting is still published once it reaches
+// live-batch-max-age. Run it with "make test".
+//
+// The connection points to a port without a router, so nothing leaves the process: a published
+// batch only shows up in the published counter of the LivePublisher.
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#include "LivePublisher.h"
+#include "WAMPConnection.h"
+
+using namespace wampinterfaceforomnetpp;
+
+/**
+ * Waits up to a second of wall-clock time for the condition, the I/O thread publishes asynchronously.
+ */
+static bool eventually(std::function<bool()> condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+static int failures = 0;
+
+static void check(bool passed, const char *what) {
+    std::cout << (passed ? "PASS " : "FAIL ") << what << std::endl;
+    if (!passed)
+        failures++;
+}
+
+int main() {
+    omnetpp::SimTime::setScaleExp(-12);
+
+    WAMPConnection connection;
+    connection.configure(WAMPConnection::TCP, "127.0.0.1", 1, "", "test");
+    connection.setRecovery(1, 1, 0);
+    connection.start();
+
+    LivePublisher publisher(connection, 64, LivePublisher::BLOCK, false);
+    LiveTopic quiet("test.quiet");
+    quiet.payload = LiveTopic::TYPED;
+    quiet.batch.limitTo(100, 1);
+    LiveTopic busy("test.busy");
+    busy.payload = LiveTopic::TYPED;
+
+    // a single sample, then the topic goes quiet
+    publisher.enqueue(&quiet, 0, 1.0);
+    publisher.advanceClock(0.5);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(publisher.getPublished() == 0, "a batch younger than max-age is kept");
+
+    publisher.advanceClock(1);
+    check(eventually([&]() {return publisher.getPublished() == 1;}),
+            "a quiet batch is published when the clock reaches max-age");
+
+    // the samples of other topics advance the clock as well
+    publisher.enqueue(&quiet, 2, 2.0);
+    publisher.enqueue(&busy, 4, 3.0);
+    check(eventually([&]() {return publisher.getPublished() == 3;}),
+            "a quiet batch is published when samples of another topic pass max-age");
+
+    connection.stop();
+    connection.join();
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,323 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+// Publishes a spool written by the LiveSpool (live-sink = spool or both) to a WAMP router,
+// paced by the simulation times of the records. Build it with "make replay-tool".
+//
+// usage: livespool-replay [options] <spool>
+//   --speedup <factor>     simulation seconds per wall-clock second, 0 publishes as fast as possible (default 1)
+//   --transport <tcp|uds>  (default tcp)
+//   --host <host>          (default 127.0.0.1)
+//   --port <port>          (default 9000)
+//   --uds-path <path>      (default /tmp/crossbar.sock)
+//   --realm <realm>        (default opplive)
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include "LiveSpoolFormat.h"
+#include "WAMPConnection.h"
+
+using namespace wampinterfaceforomnetpp;
+
+namespace {
+
+/**
+ * Number of records handed to the I/O thread at once when they are due together.
+ */
+const size_t BATCH_SIZE = 1000;
+
+struct Topic {
+    std::string uri;
+    bool typed;
+};
+
+struct Options {
+    double speedup;
+    WAMPConnection::Transport transport;
+    std::string host;
+    uint16_t port;
+    std::string udsPath;
+    std::string realm;
+    std::string spool;
+};
+
+void usage() {
+    std::cerr << "usage: livespool-replay [--speedup factor] [--transport tcp|uds] [--host host] [--port port] "
+            "[--uds-path path] [--realm realm] <spool>" << std::endl;
+    exit(2);
+}
+
+Options parseOptions(int argc, char **argv) {
+    Options options;
+    options.speedup = 1;
+    options.transport = WAMPConnection::TCP;
+    options.host = "127.0.0.1";
+    options.port = 9000;
+    options.udsPath = "/tmp/crossbar.sock";
+    options.realm = "opplive";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            if (!options.spool.empty())
+                usage();
+            options.spool = arg;
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        std::string value = argv[++i];
+        if (arg == "--speedup")
+            options.speedup = atof(value.c_str());
+        else if (arg == "--transport" && (value == "tcp" || value == "uds"))
+            options.transport = value == "tcp" ? WAMPConnection::TCP : WAMPConnection::UDS;
+        else if (arg == "--host")
+            options.host = value;
+        else if (arg == "--port")
+            options.port = atoi(value.c_str());
+        else if (arg == "--uds-path")
+            options.udsPath = value;
+        else if (arg == "--realm")
+            options.realm = value;
+        else
+            usage();
+    }
+    if (options.spool.empty() || options.speedup < 0)
+        usage();
+    return options;
+}
+
+/**
+ * Formats a raw simulation time like SimTime::str(), for topics with text payload.
+ */
+std::string formatTime(int64_t raw, int scaleExp) {
+    std::string digits = std::to_string(raw < 0 ? -(uint64_t) raw : (uint64_t) raw);
+    size_t decimals = -scaleExp;
+    if (digits.size() <= decimals)
+        digits.insert(0, decimals - digits.size() + 1, '0');
+    std::string result = digits.substr(0, digits.size() - decimals);
+    std::string fraction = digits.substr(digits.size() - decimals);
+    fraction.erase(fraction.find_last_not_of('0') + 1);
+    if (!fraction.empty())
+        result += "." + fraction;
+    return raw < 0 ? "-" + result : result;
+}
+
+template<typename T>
+std::string formatValue(const T& value) {
+    std::stringstream out;
+    out << value;
+    return out.str();
+}
+
+/**
+ * Converts a sample record into the arguments the LivePublisher publishes for it.
+ * Returns false for records of unknown kind.
+ */
+bool convertSample(const spool::RecordHeader& header, const char *payload, const Topic& topic, int scaleExp,
+        msgpack::zone& zone, msgpack::object& arguments) {
+    uint64_t word = 0;
+    if (header.length >= sizeof(word))
+        memcpy(&word, payload, sizeof(word));
+
+    msgpack::object value;
+    std::string text;
+    switch (header.kind) {
+    case spool::BOOL:
+        value = msgpack::object(word != 0, zone);
+        text = word != 0 ? "true" : "false";
+        break;
+    case spool::LONG:
+        value = msgpack::object((int64_t) word, zone);
+        text = formatValue((int64_t) word);
+        break;
+    case spool::ULONG:
+        value = msgpack::object(word, zone);
+        text = formatValue(word);
+        break;
+    case spool::DOUBLE: {
+        double d;
+        memcpy(&d, &word, sizeof(d));
+        value = msgpack::object(d, zone);
+        text = formatValue(d);
+        break;
+    }
+    case spool::SIMTIME:
+        value = msgpack::object((int64_t) word, zone);
+        text = formatTime((int64_t) word, scaleExp);
+        break;
+    case spool::STRING:
+        text.assign(payload, header.length);
+        value = msgpack::object(text, zone);
+        break;
+    default:
+        return false;
+    }
+
+    if (topic.typed)
+        arguments = msgpack::object(std::make_tuple(header.time, scaleExp, value), zone);
+    else
+        arguments = msgpack::object(std::make_tuple(formatTime(header.time, scaleExp), text), zone);
+    return true;
+}
+
+/**
+ * Converts a summary record into the arguments LivePublisher::publishSummary() publishes.
+ */
+void convertSummary(const spool::RecordHeader& header, const char *payload, int scaleExp, msgpack::zone& zone,
+        msgpack::object& arguments) {
+    spool::SummaryHeader summary;
+    memcpy(&summary, payload, sizeof(summary));
+    std::vector<double> edges, cells;
+    if (summary.numCells > 0) {
+        edges.resize(summary.numCells + 1);
+        cells.resize(summary.numCells);
+        memcpy(edges.data(), payload + sizeof(summary), edges.size() * sizeof(double));
+        memcpy(cells.data(), payload + sizeof(summary) + edges.size() * sizeof(double), cells.size() * sizeof(double));
+    }
+    arguments = msgpack::object(std::make_tuple(header.time, scaleExp, summary.count, summary.mean, summary.stddev,
+            summary.min, summary.max, edges, cells, summary.underflow, summary.overflow), zone);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options = parseOptions(argc, argv);
+
+    int fd = open(options.spool.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(spool::FileHeader)) {
+        std::cerr << "cannot read " << options.spool << std::endl;
+        return 1;
+    }
+    size_t size = status.st_size;
+    const char *data = static_cast<const char*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    if (data == MAP_FAILED) {
+        std::cerr << "cannot map " << options.spool << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    spool::FileHeader fileHeader;
+    memcpy(&fileHeader, data, sizeof(fileHeader));
+    if (memcmp(fileHeader.magic, spool::MAGIC, sizeof(fileHeader.magic)) != 0 || fileHeader.version != spool::VERSION) {
+        std::cerr << options.spool << " is not a live spool of version " << spool::VERSION << std::endl;
+        return 1;
+    }
+    // a spool whose writer crashed is as long as its mapping, only the complete records count
+    size_t end = std::min<size_t>(fileHeader.end, size);
+
+    WAMPConnection connection;
+    connection.configure(options.transport, options.host, options.port, options.udsPath, options.realm);
+    connection.start();
+    while (!connection.isJoined())
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::vector<Topic> topics;
+    std::vector<std::function<void()>> batch;
+    std::shared_ptr<msgpack::zone> zone = std::make_shared<msgpack::zone>();
+    double timeScale = std::pow(10.0, fileHeader.scaleExp);
+    bool started = false;
+    int64_t firstTime = 0;
+    std::chrono::steady_clock::time_point wallStart;
+    size_t published = 0;
+
+    auto post = [&]() {
+        if (batch.empty())
+            return;
+        std::shared_ptr<std::vector<std::function<void()>>> work = std::make_shared<std::vector<
+                std::function<void()>>>();
+        work->swap(batch);
+        connection.post([work]() {
+            for (auto& task : *work)
+                task();
+        });
+        zone = std::make_shared<msgpack::zone>();
+    };
+
+    for (size_t offset = sizeof(spool::FileHeader); offset + sizeof(spool::RecordHeader) <= end;) {
+        spool::RecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        size_t length = spool::recordLength(header.length);
+        if (offset + length > end)
+            break;
+        const char *payload = data + offset + sizeof(header);
+        offset += length;
+
+        if (header.kind == spool::TOPIC) {
+            if (header.topic >= topics.size())
+                topics.resize(header.topic + 1);
+            topics[header.topic].uri.assign(payload, header.length);
+            topics[header.topic].typed = (header.flags & spool::TYPED) != 0;
+            continue;
+        }
+        if (header.topic >= topics.size())
+            continue;
+
+        msgpack::object arguments;
+        if (header.kind == spool::SUMMARY)
+            convertSummary(header, payload, fileHeader.scaleExp, *zone, arguments);
+        else if (!convertSample(header, payload, topics[header.topic], fileHeader.scaleExp, *zone, arguments))
+            continue;
+
+        if (options.speedup > 0) {
+            if (!started) {
+                started = true;
+                firstTime = header.time;
+                wallStart = std::chrono::steady_clock::now();
+            }
+            std::chrono::duration<double> offsetTime((header.time - firstTime) * timeScale / options.speedup);
+            std::chrono::steady_clock::time_point due = wallStart
+                    + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offsetTime);
+            if (due > std::chrono::steady_clock::now()) {
+                post();
+                std::this_thread::sleep_until(due);
+            }
+        }
+
+        std::string uri = topics[header.topic].uri;
+        std::shared_ptr<msgpack::zone> owner = zone;
+        batch.push_back([&connection, uri, arguments, owner]() {
+            connection.publish(uri, arguments);
+        });
+        published++;
+        if (batch.size() >= BATCH_SIZE)
+            post();
+    }
+    post();
+
+    // the leave is posted after the events, so all of them go out
+    connection.stop();
+    connection.join();
+    std::cout << "published " << published << " events" << std::endl;
+
+    munmap(const_cast<char*>(data), size);
+    close(fd);
+    return 0;
+}